@@ -1,4 +1,6 @@
 #include "PluginEditor.h"
+#include "PsxVerbConvolver.h"
+#include "ReverbScheduler.h"
 #include "catch2/benchmark/catch_benchmark_all.hpp"
 #include "catch2/catch_test_macros.hpp"
 
@@ -38,3 +40,125 @@ TEST_CASE ("Boot performance")
         });
     };
 }
+
+TEST_CASE ("Reverb scheduler scaling")
+{
+    // One 64-sample block through many engines, for each instance count and
+    // thread count, so the results read as instances versus cores
+    constexpr int blockSize = 64;
+    const int cores = (int) std::max (1u, std::thread::hardware_concurrency());
+
+    for (int instances : { 16, 64, 256 })
+    {
+        std::vector<std::unique_ptr<PsxVerb>> verbs;
+        std::vector<std::vector<float>> left, right;
+        for (int i = 0; i < instances; ++i)
+        {
+            verbs.push_back (std::make_unique<PsxVerb>());
+            verbs.back()->init (48000);
+            verbs.back()->setPreset (i % 9);
+            left.emplace_back (blockSize);
+            right.emplace_back (blockSize);
+        }
+
+        // Each engine gets fresh input, since processing in place would feed
+        // its output back in until it blows up and goes to sleep
+        auto process = [&] (int i) {
+            auto& l = left[(size_t) i];
+            auto& r = right[(size_t) i];
+            std::fill (l.begin(), l.end(), 0.1f);
+            std::fill (r.begin(), r.end(), -0.1f);
+            verbs[(size_t) i]->process (l.data(), r.data(), blockSize);
+        };
+
+        for (int threads = 1; threads <= cores; threads *= 2)
+        {
+            ReverbScheduler scheduler (threads - 1, instances);
+            BENCHMARK (std::to_string (instances) + " instances, " + std::to_string (threads) + " threads")
+            {
+                return scheduler.run (instances, process);
+            };
+        }
+    }
+}
+
+TEST_CASE ("Convolution against the network")
+{
+    // A large block of preset 3 (a 5 s tail) and of Chaos Echo (cut off at
+    // 10 s), through the network and through convolution on 1 to all cores.
+    // Every run starts from fresh input, as processing in place would feed
+    // the last output back in until the network blows up and goes to sleep.
+    constexpr int blockSize = 4096;
+    const int cores = (int) std::max (1u, std::thread::hardware_concurrency());
+    std::vector<float> left (blockSize), right (blockSize);
+
+    for (int preset : { 3, 7 })
+    {
+        PsxVerb verb;
+        verb.init (48000);
+        verb.setPreset (preset);
+        BENCHMARK ("Preset " + std::to_string (preset) + ", network")
+        {
+            std::fill (left.begin(), left.end(), 0.1f);
+            std::fill (right.begin(), right.end(), -0.1f);
+            verb.process (left.data(), right.data(), blockSize);
+            return left[0];
+        };
+
+        for (int threads = 1; threads <= cores; threads *= 2)
+        {
+            PsxVerbConvolver convolver;
+            convolver.setNumWorkers (threads - 1);
+            convolver.init (48000);
+            convolver.setPreset (preset);
+            BENCHMARK ("Preset " + std::to_string (preset) + ", convolution, " + std::to_string (threads) + " threads")
+            {
+                std::fill (left.begin(), left.end(), 0.1f);
+                std::fill (right.begin(), right.end(), -0.1f);
+                convolver.process (left.data(), right.data(), blockSize);
+                return left[0];
+            };
+        }
+    }
+}
+
+TEST_CASE ("Ring formats")
+{
+    // One 64-sample block through every instance, at the rates where the
+    // rings are largest. Few instances stay in cache and show the conversion
+    // cost; many don't, and show what halving the memory buys back.
+    constexpr int blockSize = 64;
+    const std::pair<PsxVerb::Engine, const char*> engines[] = {
+        { PsxVerb::Engine::Float, "float" },
+        { PsxVerb::Engine::Fixed, "fixed" },
+        { PsxVerb::Engine::Half, "half" },
+        { PsxVerb::Engine::BFloat, "bfloat" },
+    };
+
+    for (int instances : { 4, 256 })
+    {
+        for (const auto& [engine, name] : engines)
+        {
+            std::vector<std::unique_ptr<PsxVerb>> verbs;
+            for (int i = 0; i < instances; ++i)
+            {
+                verbs.push_back (std::make_unique<PsxVerb>());
+                verbs.back()->setEngine (engine);
+                verbs.back()->init (96000);
+                verbs.back()->setPreset (i % 7);
+            }
+            std::vector<float> left (blockSize, 0.1f), right (blockSize, -0.1f);
+
+            BENCHMARK (std::to_string (instances) + " instances, " + name)
+            {
+                for (auto& verb : verbs)
+                {
+                    std::fill (left.begin(), left.end(), 0.1f);
+                    std::fill (right.begin(), right.end(), -0.1f);
+                    verb->process (left.data(), right.data(), blockSize);
+                }
+                return left[0];
+            };
+        }
+    }
+}
@@ -0,0 +1,183 @@
+#include "CrushStage.h"
+#include "PluginEditor.h"
+#include "catch2/catch_test_macros.hpp"
+
+#include <chrono>
+#include <limits>
+#include <map>
+#include <random>
+
+// Sweeps every preset x sample rate x block size x crush mode through both the
+// bare DSP (CrushStage + PsxVerb) and PluginProcessor::processBlock.
+// Catch's statistical benchmarks would take hours over this many cases, so
+// each case is timed directly: the best of a few passes over a fixed stretch
+// of audio.
+//
+// Results are written as JSON to $PSXVERB_BENCH_JSON (default
+// psxverb-dsp-benchmarks.json). If $PSXVERB_BENCH_BASELINE names an earlier
+// results file, any case more than $PSXVERB_BENCH_TOLERANCE (default 0.1)
+// slower than its baseline fails the test.
+
+namespace
+{
+    constexpr double secondsPerPass = 0.1;
+    constexpr int passes = 3;
+
+    struct Case
+    {
+        juce::String target;
+        int preset, crush, blockSize;
+        double rate;
+        // Ring accesses per sample the preset's network makes, which its
+        // cost should follow
+        int accesses;
+
+        juce::String key() const
+        {
+            return target + "/" + juce::String (preset) + "/" + juce::String (rate) + "/" + juce::String (blockSize) + "/" + juce::String (crush);
+        }
+    };
+
+    juce::String environment (const char* name, const juce::String& fallback)
+    {
+        const auto value = juce::SystemStats::getEnvironmentVariable (name, {});
+        return value.isNotEmpty() ? value : fallback;
+    }
+
+    // Best ns/sample of a few passes, each over secondsPerPass of audio
+    template <typename Process>
+    double timeCase (const Case& c, juce::AudioBuffer<float>& input, Process&& process)
+    {
+        juce::AudioBuffer<float> buffer (2, c.blockSize);
+        const int blocks = std::max (1, (int) (c.rate * secondsPerPass) / c.blockSize);
+        const int offsets = input.getNumSamples() / c.blockSize;
+
+        double best = std::numeric_limits<double>::max();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            double elapsed = 0.0;
+            for (int b = 0; b < blocks; ++b)
+            {
+                const int offset = (b % offsets) * c.blockSize;
+                buffer.copyFrom (0, 0, input, 0, offset, c.blockSize);
+                buffer.copyFrom (1, 0, input, 1, offset, c.blockSize);
+
+                const auto start = std::chrono::steady_clock::now();
+                process (buffer);
+                elapsed += std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now() - start).count();
+            }
+            best = std::min (best, elapsed / ((double) blocks * c.blockSize));
+        }
+        return best;
+    }
+}
+
+TEST_CASE ("DSP throughput", "[dsp]")
+{
+    auto gui = juce::ScopedJuceInitialiser_GUI {};
+
+    juce::AudioBuffer<float> input (2, 1 << 16);
+    std::mt19937 rng (1);
+    std::uniform_real_distribution<float> noise (-0.5f, 0.5f);
+    for (int ch = 0; ch < 2; ++ch)
+        for (int i = 0; i < input.getNumSamples(); ++i)
+            input.setSample (ch, i, noise (rng));
+
+    juce::Array<juce::var> results;
+    auto record = [&] (const Case& c, double nsPerSample) {
+        // Realtime factor: how many times faster than the audio plays back
+        const double realtime = 1.0e9 / (nsPerSample * c.rate);
+
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty ("key", c.key());
+        entry->setProperty ("target", c.target);
+        entry->setProperty ("preset", c.preset);
+        entry->setProperty ("rate", c.rate);
+        entry->setProperty ("block", c.blockSize);
+        entry->setProperty ("crush", c.crush);
+        entry->setProperty ("ring_accesses", c.accesses);
+        entry->setProperty ("ns_per_sample", nsPerSample);
+        entry->setProperty ("realtime", realtime);
+        results.add (juce::var (entry));
+
+        std::printf ("%-36s %8.2f ns/sample %9.1fx realtime %3d accesses\n", c.key().toRawUTF8(), nsPerSample, realtime, c.accesses);
+    };
+
+    for (double rate : { 44100.0, 48000.0, 96000.0, 192000.0 })
+    {
+        for (int blockSize = 16; blockSize <= 4096; blockSize *= 2)
+        {
+            for (int preset = 0; preset < 10; ++preset)
+            {
+                PsxVerb probe;
+                probe.init ((float) rate);
+                probe.setPreset (preset);
+                const int accesses = probe.getRingAccessesPerSample();
+
+                for (int crush = 0; crush < 4; ++crush)
+                {
+                    {
+                        const Case c { "PsxVerb", preset, crush, blockSize, rate, accesses };
+                        PsxVerb verb;
+                        verb.init ((float) rate);
+                        verb.setPreset (preset);
+                        CrushStage crusher;
+                        crusher.setCrush (crush);
+                        record (c, timeCase (c, input, [&] (juce::AudioBuffer<float>& buffer) {
+                            float* left = buffer.getWritePointer (0);
+                            float* right = buffer.getWritePointer (1);
+                            crusher.process (left, right, blockSize);
+                            verb.process (left, right, blockSize);
+                        }));
+                    }
+
+                    {
+                        const Case c { "processBlock", preset, crush, blockSize, rate, accesses };
+                        PluginProcessor plugin;
+                        auto* presetParameter = plugin.parameters.getParameter ("preset");
+                        auto* crushParameter = plugin.parameters.getParameter ("crush");
+                        presetParameter->setValueNotifyingHost (presetParameter->convertTo0to1 ((float) preset));
+                        crushParameter->setValueNotifyingHost (crushParameter->convertTo0to1 ((float) crush));
+                        plugin.prepareToPlay (rate, blockSize);
+
+                        juce::MidiBuffer midi;
+                        record (c, timeCase (c, input, [&] (juce::AudioBuffer<float>& buffer) {
+                            plugin.processBlock (buffer, midi);
+                        }));
+                    }
+                }
+            }
+        }
+    }
+
+    const auto outputFile = juce::File::getCurrentWorkingDirectory().getChildFile (environment ("PSXVERB_BENCH_JSON", "psxverb-dsp-benchmarks.json"));
+    REQUIRE (outputFile.replaceWithText (juce::JSON::toString (juce::var (results))));
+
+    const auto baselinePath = environment ("PSXVERB_BENCH_BASELINE", {});
+    if (baselinePath.isEmpty())
+        return;
+
+    const auto baseline = juce::JSON::parse (juce::File::getCurrentWorkingDirectory().getChildFile (baselinePath));
+    REQUIRE (baseline.isArray());
+
+    std::map<juce::String, double> before;
+    for (const auto& entry : *baseline.getArray())
+        before[entry["key"].toString()] = (double) entry["ns_per_sample"];
+
+    const double tolerance = environment ("PSXVERB_BENCH_TOLERANCE", "0.1").getDoubleValue();
+    int regressions = 0;
+    for (const auto& entry : results)
+    {
+        const auto found = before.find (entry["key"].toString());
+        if (found == before.end())
+            continue;
+
+        const double now = entry["ns_per_sample"];
+        if (now > found->second * (1.0 + tolerance))
+        {
+            std::printf ("REGRESSION %-36s %8.2f -> %8.2f ns/sample\n", entry["key"].toString().toRawUTF8(), found->second, now);
+            ++regressions;
+        }
+    }
+    CHECK (regressions == 0);
+}
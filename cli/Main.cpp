@@ -0,0 +1,414 @@
+// PsxVerbRender: streams audio files through PsxVerb offline, several files at
+// a time. WAV and AIFF inputs are memory-mapped through JUCE's readers; raw
+// interleaved PCM is mapped directly. Output is written a chunk at a time as
+// 32-bit float WAV, followed by the reverb tail.
+
+#include "CrushStage.h"
+#include "PsxVerb.h"
+#include "PsxVerbConvolver.h"
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Settings
+    {
+        int preset = 0;
+        int crush = 0;
+        float wet = 0.5f;
+        float dry = 0.5f;
+        float maxTailSeconds = 10.0f;
+        int jobs = (int) std::max (1u, std::thread::hardware_concurrency());
+        // Run the preset's rendered impulse responses instead of the network
+        bool convolve = false;
+        // Threads each convolving file shares its work with, besides its own
+        int convolveWorkers = 0;
+        // Half or BFloat keep the network's ring at 16 bits per cell, for
+        // many jobs at high rates
+        PsxVerb::Engine engine = PsxVerb::Engine::Float;
+        juce::File outputDirectory;
+
+        // Layout of inputs that aren't WAV or AIFF
+        double rawRate = 44100.0;
+        int rawChannels = 2;
+        bool rawIsFloat = false;
+    };
+
+    struct Result
+    {
+        juce::String name;
+        juce::String error;
+        juce::int64 samples = 0;
+        double rate = 0.0;
+        double seconds = 0.0;
+    };
+
+    // Frames read, processed and written per step
+    constexpr int CHUNK = 8192;
+    // Frames the reverb and crush see per call, like a host block
+    constexpr int BLOCK = 512;
+    // The tail ends once a whole chunk stays below this
+    constexpr float SILENCE = 1.0e-6f;
+
+    // Hands out chunks of an input's frames as separate left/right floats
+    class Source
+    {
+    public:
+        virtual ~Source() = default;
+        virtual juce::int64 getLength() const = 0;
+        virtual double getRate() const = 0;
+        virtual bool isMono() const = 0;
+        virtual void read (juce::int64 start, int numFrames, float* left, float* right) = 0;
+    };
+
+    class ReaderSource : public Source
+    {
+    public:
+        explicit ReaderSource (std::unique_ptr<juce::MemoryMappedAudioFormatReader> r)
+            : reader (std::move (r)), buffer (2, CHUNK) {}
+
+        juce::int64 getLength() const override { return reader->lengthInSamples; }
+        double getRate() const override { return reader->sampleRate; }
+        bool isMono() const override { return reader->numChannels == 1; }
+
+        void read (juce::int64 start, int numFrames, float* left, float* right) override
+        {
+            reader->read (&buffer, 0, numFrames, start, true, true);
+            std::memcpy (left, buffer.getReadPointer (0), sizeof (float) * (size_t) numFrames);
+            std::memcpy (right, buffer.getReadPointer (1), sizeof (float) * (size_t) numFrames);
+        }
+
+    private:
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader;
+        juce::AudioBuffer<float> buffer;
+    };
+
+    class RawSource : public Source
+    {
+    public:
+        RawSource (const juce::File& file, const Settings& settings)
+            : map (file, juce::MemoryMappedFile::readOnly),
+              rate (settings.rawRate),
+              channels (settings.rawChannels),
+              isFloat (settings.rawIsFloat)
+        {
+            const size_t frameBytes = (size_t) channels * (isFloat ? sizeof (float) : sizeof (int16_t));
+            length = map.getData() != nullptr ? (juce::int64) (map.getSize() / frameBytes) : 0;
+        }
+
+        bool isValid() const { return map.getData() != nullptr; }
+        juce::int64 getLength() const override { return length; }
+        double getRate() const override { return rate; }
+        bool isMono() const override { return channels == 1; }
+
+        void read (juce::int64 start, int numFrames, float* left, float* right) override
+        {
+            const int rightChannel = channels > 1 ? 1 : 0;
+            if (isFloat)
+            {
+                const auto* data = static_cast<const float*> (map.getData()) + start * channels;
+                for (int i = 0; i < numFrames; ++i)
+                {
+                    left[i] = data[i * channels];
+                    right[i] = data[i * channels + rightChannel];
+                }
+            }
+            else
+            {
+                const auto* data = static_cast<const int16_t*> (map.getData()) + start * channels;
+                for (int i = 0; i < numFrames; ++i)
+                {
+                    left[i] = (float) data[i * channels] / 32768.0f;
+                    right[i] = (float) data[i * channels + rightChannel] / 32768.0f;
+                }
+            }
+        }
+
+    private:
+        juce::MemoryMappedFile map;
+        double rate;
+        int channels;
+        bool isFloat;
+        juce::int64 length = 0;
+    };
+
+    std::unique_ptr<Source> openSource (const juce::File& file, const Settings& settings, juce::String& error)
+    {
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader;
+        if (file.hasFileExtension ("wav"))
+            reader.reset (juce::WavAudioFormat().createMemoryMappedReader (file));
+        else if (file.hasFileExtension ("aif;aiff"))
+            reader.reset (juce::AiffAudioFormat().createMemoryMappedReader (file));
+        else
+        {
+            auto raw = std::make_unique<RawSource> (file, settings);
+            if (! raw->isValid())
+            {
+                error = "can't map file";
+                return nullptr;
+            }
+            return raw;
+        }
+
+        if (reader == nullptr || ! reader->mapEntireFile())
+        {
+            error = "can't map audio file";
+            return nullptr;
+        }
+        return std::make_unique<ReaderSource> (std::move (reader));
+    }
+
+    Result render (const juce::File& input, const Settings& settings)
+    {
+        Result result;
+        result.name = input.getFileName();
+
+        auto source = openSource (input, settings, result.error);
+        if (source == nullptr)
+            return result;
+
+        const auto directory = settings.outputDirectory == juce::File() ? input.getParentDirectory() : settings.outputDirectory;
+        const auto output = directory.getChildFile (input.getFileNameWithoutExtension() + "_psxverb.wav");
+        output.deleteFile();
+
+        auto stream = output.createOutputStream (1 << 16);
+        if (stream == nullptr)
+        {
+            result.error = "can't create " + output.getFullPathName();
+            return result;
+        }
+
+        std::unique_ptr<juce::AudioFormatWriter> writer (juce::WavAudioFormat().createWriterFor (stream.get(), source->getRate(), 2, 32, {}, 0));
+        if (writer == nullptr)
+        {
+            result.error = "can't write " + output.getFullPathName();
+            return result;
+        }
+        stream.release();
+
+        PsxVerb verb;
+        PsxVerbConvolver convolver;
+        if (settings.convolve)
+        {
+            convolver.setMaxTailSeconds (settings.maxTailSeconds);
+            convolver.setNumWorkers (settings.convolveWorkers);
+            convolver.init ((float) source->getRate());
+            convolver.setPreset (settings.preset);
+            convolver.setWetGain (settings.wet);
+            convolver.setDryGain (settings.dry);
+        }
+        else
+        {
+            verb.setEngine (settings.engine);
+            verb.init ((float) source->getRate());
+            verb.setPreset (settings.preset);
+            verb.setWetGain (settings.wet);
+            verb.setDryGain (settings.dry);
+        }
+        auto reverb = [&] (float* l, float* r, int n) {
+            if (settings.convolve)
+                convolver.process (l, r, n);
+            else
+                verb.process (l, r, n);
+        };
+
+        CrushStage crusher;
+        crusher.setCrush (settings.crush);
+
+        std::vector<float> left (CHUNK), right (CHUNK);
+        const float* channels[] = { left.data(), right.data() };
+
+        const auto start = std::chrono::steady_clock::now();
+        const juce::int64 length = source->getLength();
+        const auto maxTail = (juce::int64) (settings.maxTailSeconds * source->getRate());
+
+        // Input, then silence until the tail dies away or runs too long
+        for (juce::int64 position = 0;; position += CHUNK)
+        {
+            const bool inTail = position >= length;
+            if (inTail && position - length >= maxTail)
+                break;
+
+            const int numFrames = inTail ? CHUNK : (int) std::min ((juce::int64) CHUNK, length - position);
+            if (inTail)
+            {
+                std::fill (left.begin(), left.end(), 0.0f);
+                std::fill (right.begin(), right.end(), 0.0f);
+            }
+            else
+                source->read (position, numFrames, left.data(), right.data());
+
+            for (int done = 0; done < numFrames; done += BLOCK)
+            {
+                const int n = std::min (BLOCK, numFrames - done);
+                float* l = left.data() + done;
+                float* r = right.data() + done;
+
+                // Same path as the plugin's processBlock, mono included
+                if (source->isMono())
+                {
+                    crusher.process (l, nullptr, n);
+                    reverb (l, l, n);
+                    std::memcpy (r, l, sizeof (float) * (size_t) n);
+                }
+                else
+                {
+                    crusher.process (l, r, n);
+                    reverb (l, r, n);
+                }
+            }
+
+            writer->writeFromFloatArrays (channels, 2, numFrames);
+            result.samples += numFrames;
+
+            if (inTail)
+            {
+                float peak = 0.0f;
+                for (int i = 0; i < numFrames; ++i)
+                    peak = std::max ({ peak, std::abs (left[(size_t) i]), std::abs (right[(size_t) i]) });
+                if (peak < SILENCE)
+                    break;
+            }
+        }
+
+        writer.reset();
+        result.rate = source->getRate();
+        result.seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    void printUsage()
+    {
+        std::printf ("usage: PsxVerbRender [options] files...\n"
+                     "  --preset N         reverb preset, 0-9 (default 0)\n"
+                     "  --crush N          0 Hi Def, 1 OG, 2 Crushed, 3 Scrunted (default 0)\n"
+                     "  --wet X, --dry X   gains, 0-1 (default 0.5)\n"
+                     "  --tail S           longest tail to render, in seconds (default 10)\n"
+                     "  --jobs N           files rendered at once (default: all cores)\n"
+                     "  --convolve         convolve with the preset's impulse responses, cut off\n"
+                     "                     at --tail, instead of running the network\n"
+                     "  --convolve-threads N  extra threads per file for --convolve (default 0)\n"
+                     "  --ring F           reverb RAM as float, half or bfloat (default float)\n"
+                     "  --out DIR          output directory (default: next to each input)\n"
+                     "  --raw-rate R       sample rate of raw PCM inputs (default 44100)\n"
+                     "  --raw-channels N   channels of raw PCM inputs (default 2)\n"
+                     "  --raw-float        raw PCM is 32-bit float rather than 16-bit\n");
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    Settings settings;
+    std::vector<juce::File> inputs;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        auto value = [&] { return i + 1 < argc ? juce::String (argv[++i]) : juce::String(); };
+
+        if (arg == "--preset")
+            settings.preset = juce::jlimit (0, 9, value().getIntValue());
+        else if (arg == "--crush")
+            settings.crush = juce::jlimit (0, 3, value().getIntValue());
+        else if (arg == "--wet")
+            settings.wet = value().getFloatValue();
+        else if (arg == "--dry")
+            settings.dry = value().getFloatValue();
+        else if (arg == "--tail")
+            settings.maxTailSeconds = value().getFloatValue();
+        else if (arg == "--jobs")
+            settings.jobs = std::max (1, value().getIntValue());
+        else if (arg == "--convolve")
+            settings.convolve = true;
+        else if (arg == "--convolve-threads")
+            settings.convolveWorkers = std::max (0, value().getIntValue());
+        else if (arg == "--ring")
+        {
+            const auto format = value();
+            if (format == "half")
+                settings.engine = PsxVerb::Engine::Half;
+            else if (format == "bfloat")
+                settings.engine = PsxVerb::Engine::BFloat;
+            else
+                settings.engine = PsxVerb::Engine::Float;
+        }
+        else if (arg == "--out")
+            settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile (value());
+        else if (arg == "--raw-rate")
+            settings.rawRate = value().getDoubleValue();
+        else if (arg == "--raw-channels")
+            settings.rawChannels = std::max (1, value().getIntValue());
+        else if (arg == "--raw-float")
+            settings.rawIsFloat = true;
+        else if (arg == "--help" || arg == "-h")
+        {
+            printUsage();
+            return 0;
+        }
+        else
+            inputs.push_back (juce::File::getCurrentWorkingDirectory().getChildFile (juce::String (arg)));
+    }
+
+    if (inputs.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    // Each worker takes the next file until none are left
+    std::vector<Result> results (inputs.size());
+    std::atomic<size_t> next { 0 };
+    std::vector<std::thread> workers;
+    const auto totalStart = std::chrono::steady_clock::now();
+
+    for (int w = 0; w < std::min (settings.jobs, (int) inputs.size()); ++w)
+    {
+        workers.emplace_back ([&] {
+            for (size_t f = next++; f < inputs.size(); f = next++)
+                results[f] = render (inputs[f], settings);
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+
+    const double totalSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - totalStart).count();
+
+    int failures = 0;
+    juce::int64 totalSamples = 0;
+    for (const auto& result : results)
+    {
+        if (result.error.isNotEmpty())
+        {
+            std::fprintf (stderr, "%s: %s\n", result.name.toRawUTF8(), result.error.toRawUTF8());
+            ++failures;
+            continue;
+        }
+
+        const double samplesPerSecond = (double) result.samples / std::max (result.seconds, 1.0e-9);
+        std::printf ("%s: %lld samples in %.3f s, %.0f samples/s (%.1fx realtime)\n",
+            result.name.toRawUTF8(),
+            (long long) result.samples,
+            result.seconds,
+            samplesPerSecond,
+            samplesPerSecond / result.rate);
+        totalSamples += result.samples;
+    }
+
+    std::printf ("%d files, %lld samples in %.3f s, %.0f samples/s\n",
+        (int) results.size() - failures,
+        (long long) totalSamples,
+        totalSeconds,
+        (double) totalSamples / std::max (totalSeconds, 1.0e-9));
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+
+// A change that takes effect partway through a host block
+struct BlockEvent
+{
+    enum class Type
+    {
+        Preset,
+        Crush,
+    };
+
+    // Offset into the block
+    int sample;
+    Type type;
+    int value;
+};
+
+// The events of one host block in the order they take effect, in a fixed
+// array so collecting them never allocates. Events past Capacity are
+// dropped.
+template <int Capacity>
+class BlockEvents
+{
+public:
+    void clear() { count = 0; }
+
+    // After any event already at the same sample
+    bool add (const BlockEvent& event)
+    {
+        if (count == Capacity)
+            return false;
+
+        int at = count++;
+        for (; at > 0 && events[at - 1].sample > event.sample; --at)
+            events[at] = events[at - 1];
+        events[at] = event;
+        return true;
+    }
+
+    // add(), but a full list gives up its last event of the same type for
+    // it, so the newest of each type still takes effect. Fails only if
+    // there is none to give up.
+    bool addLatest (const BlockEvent& event)
+    {
+        if (add (event))
+            return true;
+
+        int last = count - 1;
+        for (; last >= 0 && events[last].type != event.type; --last) {}
+        if (last < 0)
+            return false;
+
+        for (--count; last < count; ++last)
+            events[last] = events[last + 1];
+        return add (event);
+    }
+
+    int size() const { return count; }
+    const BlockEvent& operator[] (int index) const { return events[index]; }
+
+private:
+    BlockEvent events[Capacity];
+    int count = 0;
+};
+
+// Runs a block as segments that end at the next event or after maxSegment
+// samples, whichever comes first: apply (event) for each event as the
+// segment it starts arrives, then process (start, numSamples). Every
+// segment but those cut short by an event is maxSegment long, so the cost
+// per segment stays the same whatever the host's block size.
+template <typename Events, typename Apply, typename Process>
+void runSegments (const Events& events, int numSamples, int maxSegment, Apply&& apply, Process&& process)
+{
+    int next = 0;
+    for (int done = 0; done < numSamples;)
+    {
+        for (; next < events.size() && events[next].sample <= done; ++next)
+            apply (events[next]);
+
+        int end = std::min (numSamples, done + maxSegment);
+        if (next < events.size())
+            end = std::min (end, events[next].sample);
+
+        process (done, end - done);
+        done = end;
+    }
+
+    // Anything stamped past the end still counts, from the next block
+    for (; next < events.size(); ++next)
+        apply (events[next]);
+}
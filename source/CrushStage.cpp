@@ -0,0 +1,246 @@
+#include "CrushStage.h"
+#include "PsxVerbSimd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace
+{
+    // sum of taps[i] * (x[p + SIDE + i] + x[p + SIDE - 1 - i]), the shape both
+    // halfband branches reduce to, for four consecutive p at once
+    template <int SIDE>
+    Lanes4 symmetric4 (const float* taps, const float* x)
+    {
+        Lanes4 acc = Lanes4::broadcast (0.0f);
+        for (int i = 0; i < SIDE; i++)
+            acc = acc + Lanes4::broadcast (taps[i]) * (Lanes4::load (x + SIDE + i) + Lanes4::load (x + SIDE - 1 - i));
+        return acc;
+    }
+
+    template <int SIDE>
+    float symmetric (const float* taps, const float* x)
+    {
+        float acc = 0.0f;
+        for (int i = 0; i < SIDE; i++)
+            acc += taps[i] * (x[SIDE + i] + x[SIDE - 1 - i]);
+        return acc;
+    }
+}
+
+CrushStage::CrushStage()
+{
+    // Blackman-windowed halfband: 0.5 at the centre, zero at even offsets,
+    // normalised for unity gain at DC
+    double taps[SIDE], sum = 0.0;
+    for (int i = 0; i < SIDE; i++)
+    {
+        const double d = 2 * i + 1;
+        const double sinc = std::sin (M_PI * d / 2.0) / (M_PI * d);
+        const double window = 0.42 + 0.5 * std::cos (M_PI * d / (2 * SIDE)) + 0.08 * std::cos (2.0 * M_PI * d / (2 * SIDE));
+        taps[i] = sinc * window;
+        sum += taps[i];
+    }
+    for (int i = 0; i < SIDE; i++)
+    {
+        decimate_taps[i] = (float) (taps[i] * 0.25 / sum);
+        // Zero stuffing halves the level, the interpolator makes it up
+        interpolate_taps[i] = 2.0f * decimate_taps[i];
+    }
+
+    reset();
+}
+
+void CrushStage::reset()
+{
+    std::memset (channels, 0, sizeof (channels));
+    split_pair = false;
+}
+
+void CrushStage::setCrush (int newCrush)
+{
+    if (crush == 0 && newCrush >= 1)
+        primeHalfRate();
+    crush = newCrush;
+}
+
+void CrushStage::primeHalfRate()
+{
+    // Run the filters over recent from silence. Older input no longer
+    // reaches their output, so they end up as if they had never stopped.
+    for (auto& channel : channels)
+    {
+        std::memset (channel.even, 0, sizeof (channel.even));
+        std::memset (channel.odd, 0, sizeof (channel.odd));
+        std::memset (channel.decimated, 0, sizeof (channel.decimated));
+        float discarded[HISTORY];
+        runPairs (channel, channel.recent, discarded, HISTORY / 2);
+    }
+    split_pair = false;
+}
+
+void CrushStage::process (float* left, float* right, int numSamples)
+{
+    switch (crush)
+    {
+        case 1: processAs<1> (left, right, numSamples); break;
+        case 2: processAs<2> (left, right, numSamples); break;
+        case 3: processAs<3> (left, right, numSamples); break;
+        default: processAs<0> (left, right, numSamples); break;
+    }
+}
+
+template <int Crush>
+void CrushStage::processAs (float* left, float* right, int numSamples)
+{
+    static_assert (Crush >= 0 && Crush <= 3);
+    if constexpr (Crush == 0)
+    {
+        delay (left, channels[0].recent, numSamples);
+        if (right != nullptr)
+            delay (right, channels[1].recent, numSamples);
+        return;
+    }
+
+    remember (left, channels[0].recent, numSamples);
+    if (right != nullptr)
+        remember (right, channels[1].recent, numSamples);
+    halfRate (left, right, numSamples);
+
+    if constexpr (Crush >= 2)
+    {
+        constexpr float scale = Crush == 2 ? 2048.0f : 512.0f;
+        quantize (left, numSamples, scale);
+        if (right != nullptr)
+            quantize (right, numSamples, scale);
+    }
+}
+
+template void CrushStage::processAs<0> (float*, float*, int);
+template void CrushStage::processAs<1> (float*, float*, int);
+template void CrushStage::processAs<2> (float*, float*, int);
+template void CrushStage::processAs<3> (float*, float*, int);
+
+void CrushStage::halfRate (float* left, float* right, int numSamples)
+{
+    float* buffers[2] = { left, right };
+    const int numChannels = right != nullptr ? 2 : 1;
+
+    int i = 0;
+    while (i < numSamples)
+    {
+        if (split_pair)
+        {
+            // Odd half of the pair the last block ended in; its even
+            // half's output went out then
+            for (int ch = 0; ch < numChannels; ch++)
+            {
+                const float pair[2] = { held[ch], buffers[ch][i] };
+                float out[2];
+                runPairs (channels[ch], pair, out, 1);
+                buffers[ch][i] = out[1];
+            }
+            split_pair = false;
+            i++;
+        }
+        else if (numSamples - i == 1)
+        {
+            // An even sample on its own: hold it, its output is already known
+            for (int ch = 0; ch < numChannels; ch++)
+            {
+                held[ch] = buffers[ch][i];
+                buffers[ch][i] = channels[ch].decimated[SIDE - 1];
+            }
+            split_pair = true;
+            i++;
+        }
+        else
+        {
+            const int numPairs = std::min (CHUNK, (numSamples - i) / 2);
+            for (int ch = 0; ch < numChannels; ch++)
+                runPairs (channels[ch], buffers[ch] + i, buffers[ch] + i, numPairs);
+            i += 2 * numPairs;
+        }
+    }
+}
+
+void CrushStage::delay (float* buffer, float* recent, int numSamples)
+{
+    float line[LATENCY];
+    std::memcpy (line, recent + HISTORY - LATENCY, sizeof (line));
+    remember (buffer, recent, numSamples);
+
+    if (numSamples >= LATENCY)
+    {
+        std::memmove (buffer + LATENCY, buffer, (size_t) (numSamples - LATENCY) * sizeof (float));
+        std::memcpy (buffer, line, sizeof (line));
+        return;
+    }
+
+    std::memcpy (buffer, line, (size_t) numSamples * sizeof (float));
+}
+
+void CrushStage::remember (const float* buffer, float* recent, int numSamples)
+{
+    if (numSamples >= HISTORY)
+    {
+        std::memcpy (recent, buffer + numSamples - HISTORY, HISTORY * sizeof (float));
+        return;
+    }
+
+    std::memmove (recent, recent + numSamples, (size_t) (HISTORY - numSamples) * sizeof (float));
+    std::memcpy (recent + HISTORY - numSamples, buffer, (size_t) numSamples * sizeof (float));
+}
+
+// Takes numPairs pairs (x[2m], x[2m+1]) and writes the two outputs each pair
+// completes, which may be in place
+void CrushStage::runPairs (Channel& channel, const float* input, float* output, int numPairs)
+{
+    float* even = channel.even + EVEN_HISTORY;
+    float* odd = channel.odd + ODD_HISTORY;
+    float* decimated = channel.decimated + ODD_HISTORY;
+    for (int p = 0; p < numPairs; p++)
+    {
+        even[p] = input[2 * p];
+        odd[p] = input[2 * p + 1];
+    }
+
+    // Decimate: the even branch is just the centre tap
+    int p = 0;
+    for (; p + 4 <= numPairs; p += 4)
+        (Lanes4::broadcast (0.5f) * Lanes4::load (channel.even + p) + symmetric4<SIDE> (decimate_taps, channel.odd + p)).store (decimated + p);
+    for (; p < numPairs; p++)
+        decimated[p] = 0.5f * channel.even[p] + symmetric<SIDE> (decimate_taps, channel.odd + p);
+
+    // Interpolate: odd outputs fall on decimated samples, even ones between
+    float between[CHUNK];
+    p = 0;
+    for (; p + 4 <= numPairs; p += 4)
+        symmetric4<SIDE> (interpolate_taps, channel.decimated + p).store (between + p);
+    for (; p < numPairs; p++)
+        between[p] = symmetric<SIDE> (interpolate_taps, channel.decimated + p);
+
+    for (p = 0; p < numPairs; p++)
+    {
+        output[2 * p] = channel.decimated[p + SIDE - 1];
+        output[2 * p + 1] = between[p];
+    }
+
+    std::memmove (channel.even, channel.even + numPairs, EVEN_HISTORY * sizeof (float));
+    std::memmove (channel.odd, channel.odd + numPairs, ODD_HISTORY * sizeof (float));
+    std::memmove (channel.decimated, channel.decimated + numPairs, ODD_HISTORY * sizeof (float));
+}
+
+void CrushStage::quantize (float* buffer, int numSamples, float scale)
+{
+    const float inverse = 1.0f / scale;
+
+    int i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+        ((Lanes4::load (buffer + i) * Lanes4::broadcast (scale)).round() * Lanes4::broadcast (inverse)).store (buffer + i);
+    for (; i < numSamples; i++)
+        buffer[i] = std::round (buffer[i] * scale) * inverse;
+}
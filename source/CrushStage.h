@@ -0,0 +1,73 @@
+#pragma once
+
+// The "Crush" setting: 0 Hi Def (untouched), 1 OG (half rate), 2 Crushed
+// (half rate, 12 bit) and 3 Scrunted (half rate, 10 bit).
+//
+// Half rate runs through a halfband decimator and interpolator whose state
+// carries from one block to the next, so blocks of any length (odd ones
+// included) join up seamlessly. It delays the signal by getLatency()
+// samples, and Hi Def delays it just as much, so the latency the plugin
+// reports holds for every setting. Nothing is allocated after construction.
+class CrushStage
+{
+public:
+    CrushStage();
+
+    // Forgets the filter history, e.g. on prepareToPlay
+    void reset();
+    // Leaving Hi Def, half rate picks up from the input it passed through
+    // as if it had been running all along
+    void setCrush (int newCrush);
+
+    // right may be null for mono material
+    void process (float* left, float* right, int numSamples);
+
+    // process() for a crush setting fixed at compile time, for callers that
+    // already switch on it (see Pipeline.h). Instantiated for 0 to 3.
+    template <int Crush>
+    void processAs (float* left, float* right, int numSamples);
+
+    int getLatency() const { return LATENCY; }
+
+private:
+    // Halfband taps on each side of the centre; every other tap is zero
+    static constexpr int SIDE = 6;
+    static constexpr int LATENCY = 4 * SIDE - 2;
+    // Input that reaches the filters' outputs over the next LATENCY samples
+    static constexpr int HISTORY = 2 * LATENCY;
+    // Pairs of input samples per filter pass
+    static constexpr int CHUNK = 256;
+
+    // History each filter input needs ahead of the current pair
+    static constexpr int EVEN_HISTORY = SIDE - 1;
+    static constexpr int ODD_HISTORY = 2 * SIDE - 1;
+
+    struct Channel
+    {
+        float even[EVEN_HISTORY + CHUNK];   // x[2m]
+        float odd[ODD_HISTORY + CHUNK];     // x[2m+1]
+        float decimated[ODD_HISTORY + CHUNK];
+        // The last HISTORY input samples, oldest first, kept in every
+        // setting. Hi Def's delay line is the newest LATENCY of them, and
+        // half rate is primed from all of them.
+        float recent[HISTORY];
+    };
+
+    void primeHalfRate();
+    void halfRate (float* left, float* right, int numSamples);
+    // Hi Def: out goes the delay line, in comes the block
+    static void delay (float* buffer, float* recent, int numSamples);
+    static void remember (const float* buffer, float* recent, int numSamples);
+    void runPairs (Channel& channel, const float* input, float* output, int numPairs);
+    static void quantize (float* buffer, int numSamples, float scale);
+
+    int crush = 0;
+
+    // Pending even sample of a pair split across blocks
+    bool split_pair = false;
+    float held[2] = {};
+
+    float decimate_taps[SIDE];
+    float interpolate_taps[SIDE];
+    Channel channels[2];
+};
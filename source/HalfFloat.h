@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__F16C__)
+    #include <immintrin.h>
+    #define PSXVERB_F16C 1
+#elif defined(__ARM_FP16_FORMAT_IEEE) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define PSXVERB_FP16 1
+#endif
+
+// 16-bit float cells for PsxVerb's Half and BFloat engines. The network's
+// arithmetic stays in float; only what it stores in the ring is rounded to
+// 16 bits, to nearest even, and widened again when read. Each format converts
+// single cells and runs of them.
+
+// IEEE binary16: 11 bits of precision, up to 65504, subnormals down to 2^-24.
+// Converted by F16C or the ARM FP16 instructions where the build has them.
+struct HalfFormat
+{
+    static float widen (uint16_t h)
+    {
+#if PSXVERB_F16C
+        return _cvtsh_ss (h);
+#elif PSXVERB_FP16
+        __fp16 v;
+        std::memcpy (&v, &h, sizeof (v));
+        return (float) v;
+#else
+        const uint32_t sign = (uint32_t) (h & 0x8000u) << 16;
+        const uint32_t magnitude = h & 0x7FFFu;
+        uint32_t bits;
+        if (magnitude >= 0x7C00u) {
+            bits = 0x7F800000u | ((magnitude & 0x3FFu) << 13);
+        } else if (magnitude >= 0x0400u) {
+            // Rebias the exponent from 15 to 127
+            bits = (magnitude << 13) + ((127u - 15u) << 23);
+        } else {
+            const float subnormal = (float) magnitude * (1.0f / 16777216.0f);
+            std::memcpy (&bits, &subnormal, sizeof (bits));
+        }
+        bits |= sign;
+        float f;
+        std::memcpy (&f, &bits, sizeof (f));
+        return f;
+#endif
+    }
+
+    static uint16_t narrow (float f)
+    {
+#if PSXVERB_F16C
+        return (uint16_t) _cvtss_sh (f, 0);
+#elif PSXVERB_FP16
+        const __fp16 v = (__fp16) f;
+        uint16_t h;
+        std::memcpy (&h, &v, sizeof (h));
+        return h;
+#else
+        uint32_t bits;
+        std::memcpy (&bits, &f, sizeof (bits));
+        const uint16_t sign = (uint16_t) ((bits >> 16) & 0x8000u);
+        uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+        // Too large for a half (or rounds up past the largest), infinity or NaN
+        if (magnitude >= 0x477FF000u)
+            return (uint16_t) (sign | (magnitude > 0x7F800000u ? 0x7E00u : 0x7C00u));
+
+        // Below the smallest normal half. Adding 0.5 leaves the float's last
+        // bit worth 2^-24, a half subnormal's step, and the FPU rounds to it.
+        if (magnitude < 0x38800000u) {
+            float rounded;
+            std::memcpy (&rounded, &magnitude, sizeof (rounded));
+            rounded += 0.5f;
+            std::memcpy (&magnitude, &rounded, sizeof (magnitude));
+            return (uint16_t) (sign | (magnitude - 0x3F000000u));
+        }
+
+        // Rebias, then round the 13 bits that drop off to nearest even
+        magnitude += ((uint32_t) (15 - 127) << 23) + 0xFFFu + ((magnitude >> 13) & 1u);
+        return (uint16_t) (sign | (magnitude >> 13));
+#endif
+    }
+
+    static void widen (const uint16_t* in, float* out, int n)
+    {
+        int i = 0;
+#if PSXVERB_F16C
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps (out + i, _mm_cvtph_ps (_mm_loadl_epi64 ((const __m128i*) (in + i))));
+#elif PSXVERB_FP16
+        for (; i + 4 <= n; i += 4)
+            vst1q_f32 (out + i, vcvt_f32_f16 (vreinterpret_f16_u16 (vld1_u16 (in + i))));
+#endif
+        for (; i < n; i++)
+            out[i] = widen (in[i]);
+    }
+
+    static void narrow (const float* in, uint16_t* out, int n)
+    {
+        int i = 0;
+#if PSXVERB_F16C
+        for (; i + 4 <= n; i += 4)
+            _mm_storel_epi64 ((__m128i*) (out + i), _mm_cvtps_ph (_mm_loadu_ps (in + i), 0));
+#elif PSXVERB_FP16
+        for (; i + 4 <= n; i += 4)
+            vst1_u16 (out + i, vreinterpret_u16_f16 (vcvt_f16_f32 (vld1q_f32 (in + i))));
+#endif
+        for (; i < n; i++)
+            out[i] = narrow (in[i]);
+    }
+};
+
+// bfloat16: float's top half, so float's range with 8 bits of precision. The
+// conversions are a shift either way, which plain loops vectorize.
+struct BFloatFormat
+{
+    static float widen (uint16_t h)
+    {
+        const uint32_t bits = (uint32_t) h << 16;
+        float f;
+        std::memcpy (&f, &bits, sizeof (f));
+        return f;
+    }
+
+    static uint16_t narrow (float f)
+    {
+        uint32_t bits;
+        std::memcpy (&bits, &f, sizeof (bits));
+        // To nearest even. A NaN whose payload sits in the low half only can
+        // come out as infinity, which the network treats no differently.
+        bits += 0x7FFFu + ((bits >> 16) & 1u);
+        return (uint16_t) (bits >> 16);
+    }
+
+    static void widen (const uint16_t* in, float* out, int n)
+    {
+        for (int i = 0; i < n; i++)
+            out[i] = widen (in[i]);
+    }
+
+    static void narrow (const float* in, uint16_t* out, int n)
+    {
+        for (int i = 0; i < n; i++)
+            out[i] = narrow (in[i]);
+    }
+};
+
+// A ring cell as the float kernels see it: reads widen, writes narrow
+template <typename Format>
+class PackedCell
+{
+public:
+    explicit PackedCell (uint16_t& c) : cell (c) {}
+
+    operator float() const { return Format::widen (cell); }
+    PackedCell& operator= (float value)
+    {
+        cell = Format::narrow (value);
+        return *this;
+    }
+
+private:
+    uint16_t& cell;
+};
+
+// A pointer into a ring of packed cells, indexed like a float*
+template <typename Format>
+class PackedCells
+{
+public:
+    explicit PackedCells (uint16_t* c) : cells (c) {}
+
+    PackedCell<Format> operator[] (uint32_t index) const { return PackedCell<Format> (cells[index]); }
+    PackedCell<Format> operator[] (int index) const { return PackedCell<Format> (cells[index]); }
+    PackedCells operator+ (uint32_t offset) const { return PackedCells (cells + offset); }
+    uint16_t* data() const { return cells; }
+
+private:
+    uint16_t* cells;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "CrushStage.h"
+#include <algorithm>
+#include <cstring>
+
+// Runs a chain of stages over a block in sub-blocks of SUB_BLOCK samples:
+// every stage takes its turn on one sub-block before the next sub-block
+// starts, so the audio stays in L1 from crush through the reverb to the
+// copies instead of being pulled back out of cache once per pass.
+//
+// A stage is anything callable as stage (left, right, numSamples), where
+// right is the right channel's buffer even for mono material. The stages
+// are template arguments, picked per setting at compile time, so each
+// segment runs only the code its settings need.
+namespace pipeline
+{
+    constexpr int SUB_BLOCK = 256;
+
+    template <typename... Stages>
+    void run (float* left, float* right, int numSamples, Stages&&... stages)
+    {
+        for (int done = 0; done < numSamples; done += SUB_BLOCK)
+        {
+            const int n = std::min (SUB_BLOCK, numSamples - done);
+            (stages (left + done, right + done, n), ...);
+        }
+    }
+
+    // The crush setting, on the left channel only for mono material. Hi Def
+    // is a plain delay to line up with the others.
+    template <int Crush, bool Mono>
+    auto crush (CrushStage& stage)
+    {
+        return [&stage] (float* left, float* right, int n) { stage.processAs<Crush> (left, Mono ? nullptr : right, n); };
+    }
+
+    // Anything with PsxVerb's process(); mono material feeds both inputs
+    // from the left channel and the result is copied to the right
+    template <bool Mono, typename Verb>
+    auto reverb (Verb& verb)
+    {
+        return [&verb] (float* left, float* right, int n) {
+            if constexpr (Mono)
+            {
+                verb.process (left, left, n);
+                std::memcpy (right, left, sizeof (float) * (size_t) n);
+            }
+            else
+                verb.process (left, right, n);
+        };
+    }
+}
@@ -58,9 +58,14 @@ PluginEditor::PluginEditor (PluginProcessor& p)
     addAndMakeVisible (crushLabel);
     crushAttachment.reset (new juce::AudioProcessorValueTreeState::ComboBoxAttachment (p.parameters, "crush", crushSelector));
 
+    addAndMakeVisible (scope);
+#if PSXVERB_TELEMETRY
+    addAndMakeVisible (telemetryMeter);
+#endif
+
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    setSize (400, 420);
 }
 
 PluginEditor::~PluginEditor()
@@ -110,6 +115,15 @@ void PluginEditor::resized()
 
     area.removeFromTop (10); // spacing
 
+#if PSXVERB_TELEMETRY
+    // DSP load meter
+    telemetryMeter.setBounds (area.removeFromTop (20).withWidth (240));
+    area.removeFromTop (10); // spacing
+#endif
+
+    // Reverb scope along the bottom
+    scope.setBounds (getLocalBounds().removeFromBottom (110).reduced (10, 0).withTrimmedBottom (10));
+
     // Inspect Button
     inspectButton.setBounds(area.removeFromTop(50).withSizeKeepingCentre(100, 50));
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "PluginProcessor.h"
+#include "ReverbScope.h"
+#include "TelemetryMeter.h"
 #include "BinaryData.h"
 #include "melatonin_inspector/melatonin_inspector.h"
 
@@ -32,6 +34,10 @@ private:
     juce::Label presetLabel;
     juce::Label crushLabel;
 
+    ReverbScope scope { processorRef.getScopeFeed() };
+#if PSXVERB_TELEMETRY
+    TelemetryMeter telemetryMeter { processorRef.getTelemetry() };
+#endif
 
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> wetGainAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> dryGainAttachment;
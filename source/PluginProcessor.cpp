@@ -1,6 +1,46 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+namespace
+{
+    // Where a bus channel sits for the reverb's fold and taps. Heights fold
+    // in with the ear-level speaker below them.
+    PsxVerb::Speaker speakerFor (juce::AudioChannelSet::ChannelType type)
+    {
+        using Set = juce::AudioChannelSet;
+        switch (type)
+        {
+            case Set::LFE:
+            case Set::LFE2:
+                return { 0.0f, false };
+            case Set::left:
+            case Set::wideLeft:
+            case Set::leftSurround:
+            case Set::leftSurroundSide:
+            case Set::leftSurroundRear:
+            case Set::topFrontLeft:
+            case Set::topSideLeft:
+            case Set::topRearLeft:
+                return { -1.0f, true };
+            case Set::right:
+            case Set::wideRight:
+            case Set::rightSurround:
+            case Set::rightSurroundSide:
+            case Set::rightSurroundRear:
+            case Set::topFrontRight:
+            case Set::topSideRight:
+            case Set::topRearRight:
+                return { 1.0f, true };
+            case Set::leftCentre:
+                return { -0.5f, true };
+            case Set::rightCentre:
+                return { 0.5f, true };
+            default:
+                return { 0.0f, true };
+        }
+    }
+}
+
 //==============================================================================
 PluginProcessor::PluginProcessor()
     : AudioProcessor (BusesProperties()
@@ -19,14 +59,46 @@ PluginProcessor::PluginProcessor()
     preset = static_cast<juce::AudioParameterChoice*> (parameters.getParameter ("preset"));
 
     lastLoadedPreset = -1;
+    lastPresetIndex = -1;
+    currentPreset = 0;
     lastCrush = 0;
+    lastWet = 0.0f;
+    lastDry = 0.0f;
 
+    // The reverb allocates nothing until the first prepareToPlay
 
-    verb_.init (48000);
+    // PSXVERB_TRACE names a trace file; each instance gets its own
+    auto tracePath = juce::SystemStats::getEnvironmentVariable ("PSXVERB_TRACE", {});
+    if (juce::File::isAbsolutePath (tracePath))
+        startTrace (juce::File (tracePath).getNonexistentSibling());
 }
 
 PluginProcessor::~PluginProcessor()
 {
+    stopTimer();
+    stopTrace();
+}
+
+bool PluginProcessor::startTrace (const juce::File& file)
+{
+#if PSXVERB_TELEMETRY
+    // The old writer stops recording as it goes, so it has to go first
+    trace_.reset();
+    trace_ = std::make_unique<TraceWriter> (telemetry_, file);
+    if (!trace_->isOpen())
+        trace_.reset();
+    return trace_ != nullptr;
+#else
+    juce::ignoreUnused (file);
+    return false;
+#endif
+}
+
+void PluginProcessor::stopTrace()
+{
+#if PSXVERB_TELEMETRY
+    trace_.reset();
+#endif
 }
 
 //==============================================================================
@@ -76,7 +148,7 @@ bool PluginProcessor::isMidiEffect() const
 
 double PluginProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return verb_.getTailSeconds();
 }
 
 int PluginProcessor::getNumPrograms()
@@ -109,14 +181,48 @@ void PluginProcessor::changeProgramName (int index, const juce::String& newName)
 //==============================================================================
 void PluginProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    // Wider than stereo runs one network for the whole bus
+    const auto channels = getChannelLayoutOfBus (false, 0);
+    PsxVerb::Speaker speakers[PsxVerb::MAX_SPEAKERS];
+    const int numSpeakers = channels.size() > 2 ? std::min (channels.size(), PsxVerb::MAX_SPEAKERS) : 0;
+    for (int i = 0; i < numSpeakers; ++i)
+        speakers[i] = speakerFor (channels.getTypeOfChannel (i));
+    verb_.setSpeakers (speakers, numSpeakers);
+
+    // A restored session starts on its preset rather than fading to it
+    const int presetIndex = preset->getIndex();
+    verb_.setPreset (presetIndex);
+    lastPresetIndex = presetIndex;
+    lastLoadedPreset = presetIndex;
+    currentPreset = presetIndex;
     verb_.init (sampleRate);
+    for (auto& stage : crush_)
+        stage.reset();
+    // The same for every crush setting, so it never changes while playing
+    setLatencySamples (crush_[0].getLatency());
+    // Even a jump in a tiny host block takes a few ms to arrive
+    minRampSamples = (int) (sampleRate * 0.005);
+    lastWet = wet_gain->get();
+    lastDry = dry_gain->get();
+    verb_.setGains (lastWet, lastDry, 0);
+    scope_.prepare (sampleRate);
+    telemetry_.prepare (sampleRate);
+    startTimerHz (PROGRAM_SYNC_HZ);
     juce::ignoreUnused (samplesPerBlock);
 }
 
 void PluginProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    // spare memory, etc. The timer keeps running so a program change from
+    // the last block still reaches the parameter.
+}
+
+void PluginProcessor::timerCallback()
+{
+    const int program = pendingProgram.load (std::memory_order_relaxed);
+    if (program >= 0 && preset->getIndex() != program)
+        *preset = program;
 }
 
 bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
@@ -125,10 +231,10 @@ bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
     juce::ignoreUnused (layouts);
     return true;
 #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-        && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Mono, stereo, or any bus up to the reverb's speaker count (5.1, 7.1,
+    // Atmos beds) with the same layout in and out
+    if (layouts.getMainOutputChannelSet().isDisabled()
+        || layouts.getMainOutputChannelSet().size() > PsxVerb::MAX_SPEAKERS)
         return false;
 
         // This checks if the input layout matches the output layout
@@ -141,102 +247,144 @@ bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 #endif
 }
 
+template <int Crush, bool Mono>
+void PluginProcessor::runPipeline (float* left, float* right, int numSamples)
+{
+    pipeline::run (left, right, numSamples, pipeline::crush<Crush, Mono> (crush_[0]), pipeline::reverb<Mono> (verb_));
+}
+
+template <int Crush>
+void PluginProcessor::runSurround (float* const* channels, int numChannels, int numSamples)
+{
+    // The same sub-blocks as pipeline::run, with crush on each channel pair
+    float* block[PsxVerb::MAX_SPEAKERS];
+    for (int done = 0; done < numSamples; done += pipeline::SUB_BLOCK)
+    {
+        const int n = std::min (pipeline::SUB_BLOCK, numSamples - done);
+        for (int c = 0; c < numChannels; ++c)
+            block[c] = channels[c] + done;
+
+        for (int c = 0; c < numChannels; c += 2)
+            crush_[c / 2].processAs<Crush> (block[c], c + 1 < numChannels ? block[c + 1] : nullptr, n);
+
+        verb_.processSpeakers (block, n);
+    }
+}
+
 void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    juce::ignoreUnused (midiMessages);
     juce::ScopedNoDenormals noDenormals;
+    telemetry_.beginBlock();
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
+    const int numSamples = buffer.getNumSamples();
     // Ensure we have at least 2 output channels (stereo)
     jassert (totalNumOutputChannels >= 2);
 
-    verb_.setWetGain (wet_gain->get());
-    verb_.setDryGain (dry_gain->get());
-
-    // Handle preset changes
-    int currentPreset = preset->getIndex();
-    if (currentPreset != lastLoadedPreset)
+    // Hosts hand JUCE parameters over once per block without a time, so
+    // their changes land at the start of the block, and the gains ramp
+    // across it to where the host's next block picks up
+    const float wetTarget = wet_gain->get();
+    const float dryTarget = dry_gain->get();
+    if (wetTarget != lastWet || dryTarget != lastDry)
     {
-        verb_.setPreset (currentPreset);
-        lastLoadedPreset = currentPreset;
+        verb_.setGains (wetTarget, dryTarget, std::max (numSamples, minRampSamples));
+        lastWet = wetTarget;
+        lastDry = dryTarget;
     }
 
-    // Handle crush changes
-    int currentCrush = crush->getIndex();
-
-    // Clear any output channels beyond the first two
-    for (auto i = 2; i < totalNumOutputChannels; ++i)
-        buffer.clear (i, 0, buffer.getNumSamples());
-
-    float* leftChannel = buffer.getWritePointer (0);
-    float* rightChannel = buffer.getWritePointer (1);
-
-    // Apply downsampling if crush is 1 or greater
-    if (currentCrush >= 1)
+    events_.clear();
+    bool presetChanged = false;
+    // A program change's preset stands until the parameter moves. Whatever
+    // moves it, the timer catching up or the host's automation, is newer.
+    const int presetIndex = preset->getIndex();
+    if (presetIndex != lastPresetIndex)
     {
-        // Temporary buffers for downsampled audio
-        std::vector<float> leftDownsampled (buffer.getNumSamples() / 2);
-        std::vector<float> rightDownsampled (buffer.getNumSamples() / 2);
-
-        // Downsample
-        for (int i = 0; i < buffer.getNumSamples() / 2; ++i)
-        {
-            leftDownsampled[i] = leftChannel[i * 2];
-            if (totalNumInputChannels > 1)
-            {
-                rightDownsampled[i] = rightChannel[i * 2];
-            }
-        }
-
-        // Upsample using linear interpolation
-        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        lastPresetIndex = presetIndex;
+        pendingProgram.store (-1, std::memory_order_relaxed);
+        if (presetIndex != lastLoadedPreset)
         {
-            float fraction = (float) (i % 2) / 2.0f;
-            int index = i / 2;
-            int nextIndex = (index + 1) % (buffer.getNumSamples() / 2);
-
-            leftChannel[i] = leftDownsampled[index] * (1 - fraction) + leftDownsampled[nextIndex] * fraction;
-            if (totalNumInputChannels > 1)
-            {
-                rightChannel[i] = rightDownsampled[index] * (1 - fraction) + rightDownsampled[nextIndex] * fraction;
-            }
+            lastLoadedPreset = presetIndex;
+            events_.add ({ 0, BlockEvent::Type::Preset, lastLoadedPreset });
         }
     }
+    if (crush->getIndex() != lastCrush)
+        events_.add ({ 0, BlockEvent::Type::Crush, crush->getIndex() });
 
-    // Apply bitcrushing
-    if (currentCrush >= 2)
+    // MIDI program changes switch presets on their own sample. Setting the
+    // parameter takes its listeners' locks, so the timer does that for the
+    // host and the editor to follow.
+    for (const auto metadata : midiMessages)
     {
-        int bitDepth = (currentCrush == 2) ? 12 : 10;
-        float crushFactor = pow (2.0f, bitDepth - 1);
+        const auto message = metadata.getMessage();
+        if (!message.isProgramChange() || message.getProgramChangeNumber() >= preset->choices.size())
+            continue;
 
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+        // More than the list holds, and the newest program change still wins
+        const int program = message.getProgramChangeNumber();
+        if (events_.addLatest ({ metadata.samplePosition, BlockEvent::Type::Preset, program }))
         {
-            leftChannel[sample] = round (leftChannel[sample] * crushFactor) / crushFactor;
-            if (totalNumInputChannels > 1)
-            {
-                rightChannel[sample] = round (rightChannel[sample] * crushFactor) / crushFactor;
-            }
+            lastLoadedPreset = program;
+            pendingProgram.store (program, std::memory_order_relaxed);
         }
     }
 
-    if (totalNumInputChannels == 1)
-    {
-        // Mono input: use the same input for both channels of the reverb
-        verb_.process (leftChannel, leftChannel, buffer.getNumSamples());
-        // Copy the processed left channel to the right channel
-        memcpy (rightChannel, leftChannel, sizeof (float) * buffer.getNumSamples());
-    }
-    else
-    {
-        // Stereo input: process normally
-        verb_.process (leftChannel, rightChannel, buffer.getNumSamples());
-    }
+    auto apply = [this, &presetChanged] (const BlockEvent& event) {
+        switch (event.type)
+        {
+            case BlockEvent::Type::Preset:
+                verb_.setPreset (event.value);
+                currentPreset = event.value;
+                presetChanged = true;
+                break;
+            case BlockEvent::Type::Crush:
+                for (auto& stage : crush_)
+                    stage.setCrush (event.value);
+                lastCrush = event.value;
+                break;
+        }
+    };
+
+    // Each segment runs specialised for the crush setting it starts with,
+    // and for mono input (which uses the left channel for both sides of
+    // the reverb) or a bus wider than stereo
+    using Pipeline = void (PluginProcessor::*) (float*, float*, int);
+    static constexpr Pipeline pipelines[2][4] = {
+        { &PluginProcessor::runPipeline<0, false>, &PluginProcessor::runPipeline<1, false>, &PluginProcessor::runPipeline<2, false>, &PluginProcessor::runPipeline<3, false> },
+        { &PluginProcessor::runPipeline<0, true>, &PluginProcessor::runPipeline<1, true>, &PluginProcessor::runPipeline<2, true>, &PluginProcessor::runPipeline<3, true> },
+    };
+    using Surround = void (PluginProcessor::*) (float* const*, int, int);
+    static constexpr Surround surrounds[4] = {
+        &PluginProcessor::runSurround<0>, &PluginProcessor::runSurround<1>, &PluginProcessor::runSurround<2>, &PluginProcessor::runSurround<3>
+    };
+
+    const bool surround = verb_.getNumSpeakers() > 0 && totalNumOutputChannels == verb_.getNumSpeakers();
+    float* const* channels = buffer.getArrayOfWritePointers();
+    auto process = [&] (int start, int length) {
+        const int crushIndex = juce::jlimit (0, 3, lastCrush);
+        if (surround)
+        {
+            float* segment[PsxVerb::MAX_SPEAKERS];
+            for (int c = 0; c < totalNumOutputChannels; ++c)
+                segment[c] = channels[c] + start;
+            (this->*surrounds[crushIndex]) (segment, totalNumOutputChannels, length);
+        }
+        else
+            (this->*pipelines[totalNumInputChannels == 1 ? 1 : 0][crushIndex]) (channels[0] + start, channels[1] + start, length);
+    };
 
-    // If we have more than 2 output channels, copy the stereo output to them
-    for (auto i = 2; i < totalNumOutputChannels; ++i)
+    runSegments (events_, numSamples, pipeline::SUB_BLOCK, apply, process);
+
+    // If a stereo pair feeds more than 2 output channels, copy it to them
+    if (!surround)
     {
-        buffer.copyFrom (i, 0, buffer, i % 2, 0, buffer.getNumSamples());
+        for (auto i = 2; i < totalNumOutputChannels; ++i)
+            buffer.copyFrom (i, 0, buffer, i % 2, 0, numSamples);
     }
+
+    scope_.update (verb_, numSamples);
+
+    telemetry_.endBlock (numSamples, currentPreset, lastCrush, presetChanged);
 }
 
 //==============================================================================
@@ -1,13 +1,17 @@
 #pragma once
 
 #include <juce_audio_processors/juce_audio_processors.h>
-#include "PsxVerb.h"
+#include "BlockEvents.h"
+#include "Pipeline.h"
+#include "PsxVerbCrossfader.h"
+#include "ScopeFeed.h"
+#include "TraceWriter.h"
 
 #if (MSVC)
 #include "ipps.h"
 #endif
 
-class PluginProcessor : public juce::AudioProcessor
+class PluginProcessor : public juce::AudioProcessor, private juce::Timer
 {
 public:
     PluginProcessor();
@@ -41,6 +45,16 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
     juce::AudioProcessorValueTreeState parameters;
 
+    // Per-block timing, for the editor's meter and trace files. Does
+    // nothing when the PSXVERB_TELEMETRY option is off.
+    Telemetry& getTelemetry() { return telemetry_; }
+    // Message thread. Writes every block to a CSV file until stopTrace();
+    // false when telemetry is compiled out or the file won't open.
+    bool startTrace (const juce::File& file);
+    void stopTrace();
+
+    // Snapshots of the reverb for the editor's scope
+    ScopeFeed& getScopeFeed() { return scope_; }
 
 private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginProcessor)
@@ -50,9 +64,37 @@ private:
     juce::AudioParameterChoice* crush;
     juce::AudioParameterChoice* preset;
 
-    int lastLoadedPreset;
-    int lastCrush;
+    void timerCallback() override;
 
+    template <int Crush, bool Mono>
+    void runPipeline (float* left, float* right, int numSamples);
+    // Buses wider than stereo: every channel through one reverb network
+    template <int Crush>
+    void runSurround (float* const* channels, int numChannels, int numSamples);
 
-    PsxVerb verb_;
+    // Parameter values last acted on, and the preset the reverb has now
+    int lastLoadedPreset;
+    int lastPresetIndex;
+    int currentPreset;
+    int lastCrush;
+    float lastWet, lastDry;
+    int minRampSamples = 0;
+    // The last MIDI program change until the preset parameter moves, -1
+    // after. Set on the audio thread; the timer moves the parameter.
+    std::atomic<int> pendingProgram { -1 };
+    static constexpr int PROGRAM_SYNC_HZ = 30;
+
+    // A preset and a crush change from the parameters plus MIDI program
+    // changes; any more in one block are dropped
+    BlockEvents<64> events_;
+
+    // One per channel pair; stereo and mono only use the first
+    CrushStage crush_[PsxVerb::MAX_SPEAKERS / 2];
+    PsxVerbCrossfader verb_;
+
+    ScopeFeed scope_;
+    Telemetry telemetry_;
+#if PSXVERB_TELEMETRY
+    std::unique_ptr<TraceWriter> trace_;
+#endif
 };
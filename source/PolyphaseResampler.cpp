@@ -0,0 +1,101 @@
+#include "PolyphaseResampler.h"
+#include "PsxVerbSimd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void PolyphaseResampler::init (double inputRate, double outputRate, int maxInputBlock, int zeroCrossings)
+{
+    step = inputRate / outputRate;
+
+    // Cut off a little below the lower of the two Nyquist frequencies; when
+    // decimating the kernel widens by the same ratio to keep its zero crossings
+    const double cutoff = 0.9 * std::min (1.0, outputRate / inputRate);
+    halfWidth = (int) std::ceil (zeroCrossings / cutoff);
+
+    // One row of taps per phase, plus a closing row for positions that round
+    // up to the next sample. Rows are padded with zeros to whole vectors.
+    taps = (2 * halfWidth + 3) & ~3;
+    table.assign ((size_t) ((PHASES + 1) * taps), 0.0f);
+    for (int phase = 0; phase <= PHASES; phase++)
+    {
+        for (int k = 0; k < 2 * halfWidth; k++)
+            table[(size_t) (phase * taps + k)] = kernel ((double) phase / PHASES - (k - halfWidth + 1), cutoff);
+    }
+
+    historyL.resize ((size_t) (taps + maxInputBlock + 4));
+    historyR.resize (historyL.size());
+    reset();
+}
+
+void PolyphaseResampler::reset()
+{
+    // Start with a kernel's worth of silence so the first output is centred on
+    // the first input
+    std::fill (historyL.begin(), historyL.end(), 0.0f);
+    std::fill (historyR.begin(), historyR.end(), 0.0f);
+    numHistory = halfWidth;
+    position = (double) halfWidth;
+}
+
+int PolyphaseResampler::getMaxOutput (int numInput) const
+{
+    return (int) std::ceil (numInput / step) + 1;
+}
+
+float PolyphaseResampler::kernel (double x, double cutoff) const
+{
+    x = std::abs (x);
+    if (x >= halfWidth)
+        return 0.0f;
+
+    const double sinc = x == 0.0 ? 1.0 : std::sin (M_PI * cutoff * x) / (M_PI * cutoff * x);
+    const double window = 0.42 + 0.5 * std::cos (M_PI * x / halfWidth) + 0.08 * std::cos (2.0 * M_PI * x / halfWidth);
+    return (float) (cutoff * sinc * window);
+}
+
+int PolyphaseResampler::process (const float* inL, const float* inR, int numInput, float* outL, float* outR)
+{
+    std::copy (inL, inL + numInput, historyL.begin() + numHistory);
+    std::copy (inR, inR + numInput, historyR.begin() + numHistory);
+    numHistory += numInput;
+
+    int produced = 0;
+    while ((int) position + halfWidth < numHistory)
+    {
+        const int centre = (int) position;
+        const int phase = (int) ((position - centre) * PHASES + 0.5);
+
+        const float* coefficients = table.data() + phase * taps;
+        const float* l = historyL.data() + centre - halfWidth + 1;
+        const float* r = historyR.data() + centre - halfWidth + 1;
+        Lanes4 accL = Lanes4::broadcast (0.0f), accR = accL;
+        for (int k = 0; k < taps; k += 4)
+        {
+            const Lanes4 c = Lanes4::load (coefficients + k);
+            accL = accL + Lanes4::load (l + k) * c;
+            accR = accR + Lanes4::load (r + k) * c;
+        }
+
+        const float sumL = accL.sum();
+        const float sumR = accR.sum();
+
+        outL[produced] = sumL;
+        outR[produced] = sumR;
+        produced++;
+        position += step;
+    }
+
+    // Drop input no future output will reach
+    const int drop = std::max (0, (int) position - halfWidth + 1);
+    std::memmove (historyL.data(), historyL.data() + drop, (size_t) (numHistory - drop) * sizeof (float));
+    std::memmove (historyR.data(), historyR.data() + drop, (size_t) (numHistory - drop) * sizeof (float));
+    numHistory -= drop;
+    position -= drop;
+
+    return produced;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+// Streaming stereo resampler for arbitrary rate ratios. The windowed-sinc
+// kernel is tabulated as PHASES polyphase branches per input sample and each
+// output uses the branch nearest its fractional position.
+class PolyphaseResampler
+{
+public:
+    // maxInputBlock is the most samples a single process() call will be given;
+    // zeroCrossings sets the kernel length on each side of its centre
+    void init (double inputRate, double outputRate, int maxInputBlock, int zeroCrossings);
+    void reset();
+
+    // Consumes numInput samples and writes every output sample they complete.
+    // Returns how many were written, never more than getMaxOutput (numInput).
+    int process (const float* inL, const float* inR, int numInput, float* outL, float* outR);
+
+    int getMaxOutput (int numInput) const;
+    // Delay through the filter, in input samples
+    int getLatency() const { return halfWidth; }
+
+private:
+    static constexpr int PHASES = 256;
+
+    float kernel (double x, double cutoff) const;
+
+    double step = 1.0;     // input samples per output sample
+    double position = 0.0; // next output, in input samples from history[0]
+    int halfWidth = 0;     // kernel half length, in input samples
+    int taps = 0;          // branch length, 2 * halfWidth rounded up to whole vectors
+
+    std::vector<float> table;
+    std::vector<float> historyL, historyR;
+    int numHistory = 0;
+};
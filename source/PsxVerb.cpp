@@ -1,108 +1,1684 @@
 #include "PsxVerb.h"
+#include "HalfFloat.h"
+#include "PsxVerbSimd.h"
+#include <array>
 #include <cstring>
 #include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+namespace
+{
+    // Largest magnitude across a pair of buffers
+    float peak(const float* left, const float* right, int numSamples)
+    {
+        Lanes4 acc = Lanes4::broadcast (0.0f);
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+            acc = max (acc, max (Lanes4::load (left + i).abs(), Lanes4::load (right + i).abs()));
+
+        float result = acc.maxLane();
+        for (; i < numSamples; i++)
+            result = std::max ({ result, std::abs (left[i]), std::abs (right[i]) });
+        return result;
+    }
+
+    // First sample louder than threshold in either buffer, or numSamples
+    int firstAbove(const float* left, const float* right, int numSamples, float threshold)
+    {
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4) {
+            if (max (Lanes4::load (left + i).abs(), Lanes4::load (right + i).abs()).maxLane() > threshold)
+                break;
+        }
+        for (; i < numSamples; i++) {
+            if (std::abs (left[i]) > threshold || std::abs (right[i]) > threshold)
+                return i;
+        }
+        return numSamples;
+    }
+}
 
 PsxVerb::PsxVerb() {
     dry = 1.0f;
     wet = 1.0f;
     master = 1.0f;
+    ramp_remaining = 0;
+    wet_step = dry_step = 0.0f;
+    wet_target = dry_target = 1.0f;
     preset_index = 0;
+    rate = 0.0f;
+    max_rate = 0.0f;
+    native_rate = false;
+    resampled = false;
+    engine = Engine::Float;
+    active_engine = Engine::Float;
+    layout = Layout::Shared;
+    active_layout = Layout::Shared;
+    spu_buffer = nullptr;
+    spu_ram = nullptr;
+    spu_half = nullptr;
+    spu_buffer_capacity = 0;
+    spu_buffer_used = 0;
+    sleeping = false;
+    quiet_samples = 0;
+    quiet_limit = 0;
+    plan = {};
+    num_speakers = 0;
+    scan_region = 0;
+    scan_cell = 0;
+    std::fill (scan_sums, scan_sums + NUM_REGIONS, 0.0f);
+    std::fill (scan_counts, scan_counts + NUM_REGIONS, 0u);
+    levels = {};
+    scalar_kernel = &PsxVerb::processScalar;
+    run_kernel = &PsxVerb::processRun;
 }
 
 PsxVerb::~PsxVerb() {
-    delete[] spu_buffer;
 }
 
 void PsxVerb::init (float sampleRate)
 {
     rate = sampleRate;
-    spu_buffer_count = ceilpower2 ((uint32_t) ceil (SPU_REV_PRESET_LONGEST_COUNT * (rate / SPU_REV_RATE)));
-    spu_buffer_count_mask = spu_buffer_count - 1;
-    spu_buffer = new float[spu_buffer_count];
+
+    // Native mode only helps when the host runs faster than the SPU. The
+    // extra speakers' taps read the ring at the host rate.
+    resampled = native_rate && rate > SPU_REV_RATE && num_speakers == 0;
+    network_rate = resampled ? SPU_REV_RATE : rate;
+    if (resampled) {
+        // The decimator guards against aliasing into the network; the wet
+        // output is already dull, so the interpolator can be much shorter
+        decimator.init (rate, SPU_REV_RATE, CHUNK_MAX, 6);
+        interpolator.init (SPU_REV_RATE, rate, decimator.getMaxOutput (CHUNK_MAX), 4);
+
+        // Enough queued silence that every chunk finds all its wet samples
+        const float ratio = rate / SPU_REV_RATE;
+        wet_fifo_primed = (int) std::ceil (decimator.getLatency() + (interpolator.getLatency() + 2) * ratio) + 2;
+        wet_fifo_fill = wet_fifo_primed;
+        wet_fifo_l.assign ((size_t) (wet_fifo_primed + CHUNK_MAX + interpolator.getMaxOutput (decimator.getMaxOutput (CHUNK_MAX))), 0.0f);
+        wet_fifo_r.assign (wet_fifo_l.size(), 0.0f);
+    }
+
+    // Only the cells the last run could have written need zeroing again,
+    // everything past them is still clean (as is all of a new block)
+    if (spu_memory.data() != nullptr)
+        memset (spu_memory.data(), 0, spu_buffer_used * (active_engine == Engine::Float ? sizeof (float) : sizeof (int16_t)));
+
+    active_engine = engine;
+    active_layout = active_engine == Engine::Float && num_speakers == 0 ? layout : Layout::Shared;
+    const size_t cellSize = active_engine == Engine::Float ? sizeof (float) : sizeof (int16_t);
+    auto cellsFor = [] (float networkRate) {
+        return ceilpower2 ((uint32_t) ceil (SPU_REV_PRESET_LONGEST_COUNT * (networkRate / SPU_REV_RATE)));
+    };
+
+    // The lines' room depends on how each preset's taps fall, so it's found
+    // by laying out every preset in turn
+    auto linesCellsFor = [&] (float networkRate) {
+        network_rate = networkRate;
+        spu_buffer_capacity = cellsFor (networkRate);
+        spu_buffer = nullptr;
+        uint32_t cells = 0;
+        for (int p = 0; p < NUM_PRESETS; p++) {
+            loadPreset (p);
+            cells = std::max (cells, lines_cells);
+        }
+        return cells;
+    };
+
+    // Reserve for the highest rate this engine may be initialised at, so a
+    // host flipping between rates keeps the same block
+    const float reserveRate = resampled ? SPU_REV_RATE : std::max (rate, max_rate);
+    size_t cells = std::max (cellsFor (network_rate), cellsFor (reserveRate));
+    if (active_layout == Layout::Lines) {
+        const float networkRate = network_rate;
+        const int presetIndex = preset_index;
+        const uint32_t reserveCells = linesCellsFor (reserveRate);
+        // Back at the actual rate last
+        cells = std::max (reserveCells, linesCellsFor (networkRate));
+        preset_index = presetIndex;
+    }
+
+    void* memory = spu_memory.reserve (cells * cellSize);
+    if (memory == nullptr)
+        throw std::bad_alloc();
+    spu_buffer_capacity = cellsFor (network_rate);
+
+    spu_buffer = active_engine == Engine::Float ? static_cast<float*> (memory) : nullptr;
+    spu_ram = active_engine == Engine::Fixed ? static_cast<int16_t*> (memory) : nullptr;
+    spu_half = active_engine == Engine::Half || active_engine == Engine::BFloat ? static_cast<uint16_t*> (memory) : nullptr;
 
     BufferAddress = 0;
+    spu_buffer_used = 0;
+    clear_position = clear_end = 0;
+    sleeping = false;
+    quiet_samples = 0;
 
-    memset (spu_buffer, 0, spu_buffer_count * sizeof (float));
     loadPreset (preset_index);
 }
 
 
 void PsxVerb::process(float* leftBuffer, float* rightBuffer, int numSamples) {
+    // The network can't make a sound, so it doesn't run at all. The ring
+    // keeps its contents; running it would only have touched the few cells
+    // of Off's window.
+    float wetGains[CHUNK_MAX], dryGains[CHUNK_MAX];
+    if (plan.inert) {
+        const float inL = vLIN, inR = vRIN, masterGain = master;
+        for (int done = 0; done < numSamples; done += CHUNK_MAX) {
+            float* left = leftBuffer + done;
+            float* right = rightBuffer + done;
+            const int n = std::min (CHUNK_MAX, numSamples - done);
+            if (!nextGains(wetGains, dryGains, n))
+                std::fill (dryGains, dryGains + n, dry);
+            for (int i = 0; i < n; i++) {
+                left[i] = left[i] * inL * dryGains[i] * masterGain;
+                right[i] = right[i] * inR * dryGains[i] * masterGain;
+            }
+        }
+        return;
+    }
+
+    float Lin[CHUNK_MAX], Rin[CHUNK_MAX];
+    float Lout[CHUNK_MAX], Rout[CHUNK_MAX];
+
+    for (int done = 0; done < numSamples; done += CHUNK_MAX) {
+        float* left = leftBuffer + done;
+        float* right = rightBuffer + done;
+        const int n = std::min (CHUNK_MAX, numSamples - done);
+
+        const float inL = vLIN, inR = vRIN;
+        for (int i = 0; i < n; i++) {
+            Lin[i] = inL * left[i];
+            Rin[i] = inR * right[i];
+        }
+
+        const int start = runChunk(Lin, Rin, Lout, Rout, n);
+
+        // Output to buffer, only the dry path up to where the network woke
+        if (nextGains(wetGains, dryGains, n)) {
+            const float masterGain = master;
+            for (int i = 0; i < start; i++) {
+                left[i] = Lin[i] * (dryGains[i] * masterGain);
+                right[i] = Rin[i] * (dryGains[i] * masterGain);
+            }
+            for (int i = start; i < n; i++) {
+                left[i] = (Lout[i] * wetGains[i] + Lin[i] * dryGains[i]) * masterGain;
+                right[i] = (Rout[i] * wetGains[i] + Rin[i] * dryGains[i]) * masterGain;
+            }
+            continue;
+        }
+
+        const float wetGain = wet, dryGain = dry, masterGain = master;
+        const float asleepGain = dryGain * masterGain;
+        for (int i = 0; i < start; i++) {
+            left[i] = Lin[i] * asleepGain;
+            right[i] = Rin[i] * asleepGain;
+        }
+        for (int i = start; i < n; i++) {
+            left[i] = (Lout[i] * wetGain + Lin[i] * dryGain) * masterGain;
+            right[i] = (Rout[i] * wetGain + Rin[i] * dryGain) * masterGain;
+        }
+    }
+}
+
+int PsxVerb::runChunk(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples) {
+    // Asleep the ring is silent, so up to the first audible input sample
+    // only the dry path sounds. The network picks up from that sample.
+    int start = 0;
+    if (sleeping) {
+        start = firstAbove(Lin, Rin, numSamples, SILENCE);
+        if (start == numSamples) {
+            if (clear_position < clear_end)
+                clearSome(SLEEP_CLEAR_SLICE);
+            return numSamples;
+        }
+
+        // Whatever is left uncleared is below SILENCE anyway
+        sleeping = false;
+        quiet_samples = 0;
+        clear_end = clear_position;
+    }
+
+    const int count = numSamples - start;
+    if (resampled)
+        processResampled(Lin + start, Rin + start, Lout + start, Rout + start, count);
+    else
+        processNetwork(Lin + start, Rin + start, Lout + start, Rout + start, count);
+
+    trackSilence(Lin + start, Rin + start, Lout + start, Rout + start, count);
+    return start;
+}
+
+void PsxVerb::processSpeakers(float* const* channels, int numSamples) {
+    const int count = num_speakers;
+    const float inL = vLIN, inR = vRIN;
+    // A speaker's dry path takes the input gain of the side it's on
+    auto dryInput = [&] (int c) {
+        const float pan = speakers[c].pan;
+        return pan < 0.0f ? inL : pan > 0.0f ? inR : avg(inL, inR);
+    };
+
+    // Every speaker takes the same gains, ramping or not
+    float wetGains[BLOCK_MAX], dryGains[BLOCK_MAX];
+    auto gainsFor = [&] (int n) {
+        if (!nextGains(wetGains, dryGains, n)) {
+            std::fill (wetGains, wetGains + n, wet);
+            std::fill (dryGains, dryGains + n, dry);
+        }
+    };
+
+    if (plan.inert) {
+        const float masterGain = master;
+        for (int done = 0; done < numSamples; done += BLOCK_MAX) {
+            const int n = std::min (BLOCK_MAX, numSamples - done);
+            gainsFor(n);
+            for (int c = 0; c < count; c++) {
+                const float dryIn = dryInput(c);
+                float* channel = channels[c] + done;
+                for (int i = 0; i < n; i++)
+                    channel[i] = channel[i] * dryIn * dryGains[i] * masterGain;
+            }
+        }
+        return;
+    }
+
+    float Lin[BLOCK_MAX], Rin[BLOCK_MAX];
+    float Lout[BLOCK_MAX], Rout[BLOCK_MAX], own[BLOCK_MAX];
+
+    for (int done = 0; done < numSamples; done += BLOCK_MAX) {
+        const int n = std::min (BLOCK_MAX, numSamples - done);
+
+        std::fill (Lin, Lin + n, 0.0f);
+        std::fill (Rin, Rin + n, 0.0f);
+        for (int c = 0; c < count; c++) {
+            const SpeakerState& s = speaker_state[c];
+            const float* in = channels[c] + done;
+            if (s.foldL != 0.0f) {
+                for (int i = 0; i < n; i++)
+                    Lin[i] += s.foldL * in[i];
+            }
+            if (s.foldR != 0.0f) {
+                for (int i = 0; i < n; i++)
+                    Rin[i] += s.foldR * in[i];
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            Lin[i] *= inL;
+            Rin[i] *= inR;
+        }
+
+        const uint32_t address = BufferAddress;
+        const int start = runChunk(Lin, Rin, Lout, Rout, n);
+
+        gainsFor(n);
+        const float masterGain = master;
+        for (int c = 0; c < count; c++) {
+            const SpeakerState& s = speaker_state[c];
+            float* out = channels[c] + done;
+            const float dryIn = dryInput(c);
+
+            // A speaker whose taps couldn't be placed for this preset
+            // shares the network output on its side
+            const int main = s.main >= 0 || s.num_taps > 0 ? s.main : speakers[c].pan > 0.0f ? 1 : 0;
+            const float* wetOut = main == 0 ? Lout : main == 1 ? Rout : own;
+            if (!speakers[c].wet) {
+                for (int i = 0; i < n; i++)
+                    out[i] = out[i] * dryIn * (dryGains[i] * masterGain);
+                continue;
+            }
+            if (main < 0 && start < n) {
+                std::fill (own + start, own + n, 0.0f);
+                readSpeakerTaps(c, address, own + start, n - start);
+            }
+
+            for (int i = 0; i < start; i++)
+                out[i] = out[i] * dryIn * (dryGains[i] * masterGain);
+            for (int i = start; i < n; i++)
+                out[i] = (wetOut[i] * wetGains[i] + out[i] * dryIn * dryGains[i]) * masterGain;
+        }
+    }
+}
+
+void PsxVerb::readSpeakerTaps(int speaker, uint32_t address, float* out, int numSamples) const {
+    const SpeakerState& s = speaker_state[speaker];
+    const uint32_t mask = spu_buffer_count_mask;
+    for (int k = 0; k < s.num_taps; k++) {
+        const uint32_t tap = s.taps[k] + address;
+        const float gain = s.gains[k];
+        if (active_engine == Engine::Float) {
+            for (int i = 0; i < numSamples; i++)
+                out[i] += gain * spu_buffer[(tap + (uint32_t) i) & mask];
+        } else {
+            for (int i = 0; i < numSamples; i++)
+                out[i] += gain * readCell((tap + (uint32_t) i) & mask);
+        }
+    }
+}
+
+// Counts silent samples going into and out of the network (before the wet
+// gain, so turning it down doesn't lose a tail) and goes to sleep after a
+// whole ring of them: by then every cell has passed under the comb taps.
+void PsxVerb::trackSilence(const float* Lin, const float* Rin, const float* Lout, const float* Rout, int numSamples) {
+    const float wetSilence = active_engine == Engine::Fixed ? FIXED_SILENCE : active_engine == Engine::Half ? HALF_SILENCE : SILENCE;
+    const float dryPeak = peak(Lin, Rin, numSamples);
+    const float wetPeak = peak(Lout, Rout, numSamples);
+    levels.dry = std::max (levels.dry, dryPeak);
+    levels.wet = std::max (levels.wet, wetPeak);
+    if (dryPeak > SILENCE || wetPeak > wetSilence) {
+        quiet_samples = 0;
+        return;
+    }
+
+    quiet_samples += numSamples;
+    if (quiet_samples >= quiet_limit) {
+        sleeping = true;
+        // Starts from zero on waking rather than the leftovers
+        startClearing();
+    }
+}
+
+double PsxVerb::getTailSeconds() const {
+    if (ringsForever())
+        return std::numeric_limits<double>::infinity();
+    return preset_index >= 0 && preset_index < NUM_PRESETS ? tail_seconds[preset_index] : 0.0;
+}
+
+bool PsxVerb::ringsForever() const {
+    return preset_index >= 0 && preset_index < NUM_PRESETS && rings_forever[preset_index];
+}
+
+PsxVerb::Levels PsxVerb::takeLevels() {
+    const Levels taken = levels;
+    levels = {};
+    return taken;
+}
+
+bool PsxVerb::scanRing(uint32_t maxCells, RingEnergy& energy) {
+    if (spu_memory.data() == nullptr)
+        return false;
+
+    // Where each line's history is and how long it runs. In the shared ring
+    // it's the stretch below the line's write position down to the next
+    // line's, which overwrites anything older.
+    const bool isLines = active_layout == Layout::Lines;
+    const uint32_t mask = spu_buffer_count_mask;
+    const uint32_t written[NUM_REGIONS] = { mLSAME, mRSAME, mLDIFF, mRDIFF, mLAPF1, mRAPF1, mLAPF2, mRAPF2 };
+    auto regionLength = [&] (int region) {
+        if (isLines)
+            return lines[region].length;
+        uint32_t length = spu_buffer_count;
+        for (int other = 0; other < NUM_REGIONS; other++) {
+            const uint32_t distance = (written[region] - written[other]) & mask;
+            if (distance != 0)
+                length = std::min (length, distance);
+        }
+        return length;
+    };
+
+    while (maxCells > 0) {
+        if (scan_region == NUM_REGIONS) {
+            for (int region = 0; region < NUM_REGIONS; region++) {
+                energy.rms[region] = std::sqrt (scan_sums[region] / (float) std::max (1u, scan_counts[region]));
+                energy.seconds[region] = (float) regionLength(region) / network_rate;
+                scan_sums[region] = 0.0f;
+                scan_counts[region] = 0;
+            }
+            scan_region = 0;
+            scan_cell = 0;
+            return true;
+        }
+
+        const uint32_t length = regionLength(scan_region);
+        if (scan_cell >= length) {
+            scan_region++;
+            scan_cell = 0;
+            continue;
+        }
+
+        const uint32_t end = std::min (length, scan_cell + maxCells);
+        float sum = 0.0f;
+        uint32_t count = 0;
+        for (uint32_t cell = scan_cell; cell < end; cell += SCAN_STRIDE, count++) {
+            float value;
+            if (isLines)
+                value = lines[scan_region].data[cell];
+            else
+                value = readCell((written[scan_region] + BufferAddress - cell) & mask);
+            sum += value * value;
+        }
+        scan_sums[scan_region] += sum;
+        scan_counts[scan_region] += count;
+        maxCells -= std::min (maxCells, count * SCAN_STRIDE);
+        scan_cell += count * SCAN_STRIDE;
+    }
+    return false;
+}
+
+void PsxVerb::processResampled(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples) {
+    // Only the wet path goes through the SPU rate, the dry signal stays as is
+    float nativeInL[CHUNK_MAX + 2], nativeInR[CHUNK_MAX + 2];
+    float nativeOutL[CHUNK_MAX + 2], nativeOutR[CHUNK_MAX + 2];
+
+    const int native = decimator.process(Lin, Rin, numSamples, nativeInL, nativeInR);
+    processNetwork(nativeInL, nativeInR, nativeOutL, nativeOutR, native);
+
+    // The interpolator doesn't finish exactly numSamples outputs per block, so
+    // its output queues behind a little silence primed in init()
+    const int produced = interpolator.process(nativeOutL, nativeOutR, native,
+        wet_fifo_l.data() + wet_fifo_fill, wet_fifo_r.data() + wet_fifo_fill);
+    wet_fifo_fill += produced;
+
+    const int available = std::min (numSamples, wet_fifo_fill);
+    std::copy (wet_fifo_l.begin(), wet_fifo_l.begin() + available, Lout);
+    std::copy (wet_fifo_r.begin(), wet_fifo_r.begin() + available, Rout);
+    std::fill (Lout + available, Lout + numSamples, 0.0f);
+    std::fill (Rout + available, Rout + numSamples, 0.0f);
+
+    std::copy (wet_fifo_l.begin() + available, wet_fifo_l.begin() + wet_fifo_fill, wet_fifo_l.begin());
+    std::copy (wet_fifo_r.begin() + available, wet_fifo_r.begin() + wet_fifo_fill, wet_fifo_r.begin());
+    wet_fifo_fill -= available;
+}
+
+void PsxVerb::processNetwork(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples) {
+    if (active_layout == Layout::Lines) {
+        for (int done = 0; done < numSamples;) {
+            const int n = linesRunLength(numSamples - done);
+            processLines(Lin + done, Rin + done, Lout + done, Rout + done, n);
+            done += n;
+        }
+        return;
+    }
+
+    const bool isFixed = active_engine == Engine::Fixed;
+    if (block_limit < BLOCK_MIN) {
+        if (isFixed)
+            processFixedScalar(Lin, Rin, Lout, Rout, numSamples);
+        else
+            (this->*scalar_kernel)(Lin, Rin, Lout, Rout, numSamples);
+        return;
+    }
+
+    int done = 0;
+    while (done < numSamples) {
+        const int n = runLength(numSamples - done);
+        if (n < BLOCK_MIN) {
+            if (isFixed)
+                processFixedScalar(Lin + done, Rin + done, Lout + done, Rout + done, n);
+            else
+                (this->*scalar_kernel)(Lin + done, Rin + done, Lout + done, Rout + done, n);
+        } else {
+            if (isFixed)
+                processFixedRun(Lin + done, Rin + done, Lout + done, Rout + done, n);
+            else
+                (this->*run_kernel)(Lin + done, Rin + done, Lout + done, Rout + done, n);
+        }
+        done += n;
+    }
+}
+
+// The preset the float kernels run, copied out of the members so stores
+// into the ring can't alias them
+struct PsxVerb::Registers {
+    bool hasComb2, hasComb3, hasComb4, hasWall, hasApf1, hasApf2;
+    uint32_t dAPF1, dAPF2;
+    float vIIR, vCOMB1, vCOMB2, vCOMB3, vCOMB4, vWALL, vAPF1, vAPF2;
+    uint32_t mLSAME, mRSAME, mLCOMB1, mRCOMB1, mLCOMB2, mRCOMB2;
+    uint32_t dLSAME, dRSAME, mLDIFF, mRDIFF, mLCOMB3, mRCOMB3, mLCOMB4, mRCOMB4;
+    uint32_t dLDIFF, dRDIFF, mLAPF1, mRAPF1, mLAPF2, mRAPF2;
+};
+
+PsxVerb::Registers PsxVerb::registers() const {
+    return { plan.comb2, plan.comb3, plan.comb4, plan.wall, plan.apf1, plan.apf2,
+        dAPF1, dAPF2, vIIR, vCOMB1, vCOMB2, vCOMB3, vCOMB4, vWALL, vAPF1, vAPF2,
+        mLSAME, mRSAME, mLCOMB1, mRCOMB1, mLCOMB2, mRCOMB2,
+        dLSAME, dRSAME, mLDIFF, mRDIFF, mLCOMB3, mRCOMB3, mLCOMB4, mRCOMB4,
+        dLDIFF, dRDIFF, mLAPF1, mRAPF1, mLAPF2, mRAPF2 };
+}
+
+float PsxVerb::readCell(uint32_t index) const {
+    switch (active_engine) {
+        case Engine::Fixed: return s2f(spu_ram[index]);
+        case Engine::Half: return HalfFormat::widen(spu_half[index]);
+        case Engine::BFloat: return BFloatFormat::widen(spu_half[index]);
+        case Engine::Float: break;
+    }
+    return spu_buffer[index];
+}
+
+void PsxVerb::processScalar(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples) {
+    processScalarWith(spu_buffer, registers(), Lin, Rin, Lout, Rout, numSamples);
+}
+
+void PsxVerb::processRun(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples) {
+    processRunWith(spu_buffer, registers(), Lin, Rin, Lout, Rout, numSamples);
+}
+
+template <int Preset, int Rate>
+void PsxVerb::processScalarAs(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples) {
+    processScalarWith(spu_buffer, Constants<Preset, Rate>{}, Lin, Rin, Lout, Rout, numSamples);
+}
+
+template <int Preset, int Rate>
+void PsxVerb::processRunAs(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples) {
+    processRunWith(spu_buffer, Constants<Preset, Rate>{}, Lin, Rin, Lout, Rout, numSamples);
+}
+
+// The 16-bit engines run the generic kernels only; the ring traffic they
+// halve is what they're for, not the address arithmetic
+template <typename Format>
+void PsxVerb::processPackedScalar(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples) {
+    processScalarWith(PackedCells<Format>(spu_half), registers(), Lin, Rin, Lout, Rout, numSamples);
+}
+
+template <typename Format>
+void PsxVerb::processPackedRun(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples) {
+    processRunWith(PackedCells<Format>(spu_half), registers(), Lin, Rin, Lout, Rout, numSamples);
+}
+
+// The has* flags leave out the terms loadPreset() found a zero coefficient
+// for, see Plan. They're compile-time constants in the Constants kernels.
+template <typename Ring, typename Taps>
+void PsxVerb::processScalarWith(Ring ring, const Taps& t, const float* LinBuffer, const float* RinBuffer, float* LoutBuffer, float* RoutBuffer, int numSamples) {
+    const uint32_t mask = spu_buffer_count_mask;
+    uint32_t address = BufferAddress;
+    auto cell = [&] (uint32_t offset) -> decltype(auto) {
+        return ring[(offset + address) & mask];
+    };
+
+    auto reflect = [&] (float in, uint32_t wallTap, uint32_t line) {
+        if (t.hasWall)
+            in += cell(wallTap) * t.vWALL;
+        cell(line) = (in - cell(line - 1)) * t.vIIR + cell(line - 1);
+    };
+
+    auto apf = [&] (float out, uint32_t m, uint32_t d, float v, bool active) {
+        if (active) {
+            out -= v * cell(m - d);
+            cell(m) = out;
+            return out * v + cell(m - d);
+        } else {
+            cell(m) = out;
+            return (float) cell(m - d);
+        }
+    };
+
+    auto combs = [&] (uint32_t m1, uint32_t m2, uint32_t m3, uint32_t m4) {
+        float out = t.vCOMB1 * cell(m1);
+        if (t.hasComb2)
+            out += t.vCOMB2 * cell(m2);
+        if (t.hasComb3)
+            out += t.vCOMB3 * cell(m3);
+        if (t.hasComb4)
+            out += t.vCOMB4 * cell(m4);
+        return out;
+    };
+
     for (int i = 0; i < numSamples; i++) {
-        const float Lin = vLIN * leftBuffer[i];
-        const float Rin = vRIN * rightBuffer[i];
+        const float Lin = LinBuffer[i];
+        const float Rin = RinBuffer[i];
 
         // Same side reflection
-        spu_buffer[(mLSAME + BufferAddress) & spu_buffer_count_mask] =
-            (Lin + spu_buffer[(dLSAME + BufferAddress) & spu_buffer_count_mask] * vWALL -
-                spu_buffer[(mLSAME + BufferAddress - 1) & spu_buffer_count_mask]) * vIIR +
-            spu_buffer[(mLSAME + BufferAddress - 1) & spu_buffer_count_mask];
-
-        spu_buffer[(mRSAME + BufferAddress) & spu_buffer_count_mask] =
-            (Rin + spu_buffer[(dRSAME + BufferAddress) & spu_buffer_count_mask] * vWALL -
-                spu_buffer[(mRSAME + BufferAddress - 1) & spu_buffer_count_mask]) * vIIR +
-            spu_buffer[(mRSAME + BufferAddress - 1) & spu_buffer_count_mask];
+        reflect(Lin, t.dLSAME, t.mLSAME);
+        reflect(Rin, t.dRSAME, t.mRSAME);
 
         // Different side reflection
-        spu_buffer[(mLDIFF + BufferAddress) & spu_buffer_count_mask] =
-            (Lin + spu_buffer[(dRDIFF + BufferAddress) & spu_buffer_count_mask] * vWALL -
-                spu_buffer[(mLDIFF + BufferAddress - 1) & spu_buffer_count_mask]) * vIIR +
-            spu_buffer[(mLDIFF + BufferAddress - 1) & spu_buffer_count_mask];
-
-        spu_buffer[(mRDIFF + BufferAddress) & spu_buffer_count_mask] =
-            (Rin + spu_buffer[(dLDIFF + BufferAddress) & spu_buffer_count_mask] * vWALL -
-                spu_buffer[(mRDIFF + BufferAddress - 1) & spu_buffer_count_mask]) * vIIR +
-            spu_buffer[(mRDIFF + BufferAddress - 1) & spu_buffer_count_mask];
+        reflect(Lin, t.dRDIFF, t.mLDIFF);
+        reflect(Rin, t.dLDIFF, t.mRDIFF);
 
         // Early echo
-        float Lout = vCOMB1 * spu_buffer[(mLCOMB1 + BufferAddress) & spu_buffer_count_mask] +
-            vCOMB2 * spu_buffer[(mLCOMB2 + BufferAddress) & spu_buffer_count_mask] +
-            vCOMB3 * spu_buffer[(mLCOMB3 + BufferAddress) & spu_buffer_count_mask] +
-            vCOMB4 * spu_buffer[(mLCOMB4 + BufferAddress) & spu_buffer_count_mask];
-
-        float Rout = vCOMB1 * spu_buffer[(mRCOMB1 + BufferAddress) & spu_buffer_count_mask] +
-            vCOMB2 * spu_buffer[(mRCOMB2 + BufferAddress) & spu_buffer_count_mask] +
-            vCOMB3 * spu_buffer[(mRCOMB3 + BufferAddress) & spu_buffer_count_mask] +
-            vCOMB4 * spu_buffer[(mRCOMB4 + BufferAddress) & spu_buffer_count_mask];
+        float Lout = combs(t.mLCOMB1, t.mLCOMB2, t.mLCOMB3, t.mLCOMB4);
+        float Rout = combs(t.mRCOMB1, t.mRCOMB2, t.mRCOMB3, t.mRCOMB4);
 
         // Late reverb APF1
-        Lout -= vAPF1 * spu_buffer[(mLAPF1 + BufferAddress - dAPF1) & spu_buffer_count_mask];
-        spu_buffer[(mLAPF1 + BufferAddress) & spu_buffer_count_mask] = Lout;
-        Lout = Lout * vAPF1 + spu_buffer[(mLAPF1 + BufferAddress - dAPF1) & spu_buffer_count_mask];
-
-        Rout -= vAPF1 * spu_buffer[(mRAPF1 + BufferAddress - dAPF1) & spu_buffer_count_mask];
-        spu_buffer[(mRAPF1 + BufferAddress) & spu_buffer_count_mask] = Rout;
-        Rout = Rout * vAPF1 + spu_buffer[(mRAPF1 + BufferAddress - dAPF1) & spu_buffer_count_mask];
+        Lout = apf(Lout, t.mLAPF1, t.dAPF1, t.vAPF1, t.hasApf1);
+        Rout = apf(Rout, t.mRAPF1, t.dAPF1, t.vAPF1, t.hasApf1);
 
         // Late reverb APF2
-        Lout -= vAPF2 * spu_buffer[(mLAPF2 + BufferAddress - dAPF2) & spu_buffer_count_mask];
-        spu_buffer[(mLAPF2 + BufferAddress) & spu_buffer_count_mask] = Lout;
-        Lout = Lout * vAPF2 + spu_buffer[(mLAPF2 + BufferAddress - dAPF2) & spu_buffer_count_mask];
+        Lout = apf(Lout, t.mLAPF2, t.dAPF2, t.vAPF2, t.hasApf2);
+        Rout = apf(Rout, t.mRAPF2, t.dAPF2, t.vAPF2, t.hasApf2);
+
+        address = (address + 1) & mask;
+
+        LoutBuffer[i] = Lout;
+        RoutBuffer[i] = Rout;
+    }
+
+    BufferAddress = address;
+}
+
+int PsxVerb::runLength(int numSamples) const
+{
+    // A run must not wrap around the end of the ring for any of its taps
+    uint32_t furthest = 0;
+    for (int t = 0; t < num_block_taps; t++)
+        furthest = std::max (furthest, (block_taps[t] + BufferAddress) & spu_buffer_count_mask);
+
+    return std::min ({ numSamples, block_limit, (int) (spu_buffer_count - furthest) });
+}
+
+namespace
+{
+    // A run of ring cells as floats, for a pass that only reads them. The
+    // float ring is read in place; a packed one is widened into scratch
+    // first, a vector at a time where the converters allow.
+    const float* readRun(const float* cells, int, float*)
+    {
+        return cells;
+    }
 
-        Rout -= vAPF2 * spu_buffer[(mRAPF2 + BufferAddress - dAPF2) & spu_buffer_count_mask];
-        spu_buffer[(mRAPF2 + BufferAddress) & spu_buffer_count_mask] = Rout;
-        Rout = Rout * vAPF2 + spu_buffer[(mRAPF2 + BufferAddress - dAPF2) & spu_buffer_count_mask];
+    template <typename Format>
+    const float* readRun(PackedCells<Format> cells, int numSamples, float* scratch)
+    {
+        Format::widen (cells.data(), scratch, numSamples);
+        return scratch;
+    }
+
+    void writeRun(const float* values, int numSamples, float* cells)
+    {
+        std::copy (values, values + numSamples, cells);
+    }
+
+    template <typename Format>
+    void writeRun(const float* values, int numSamples, PackedCells<Format> cells)
+    {
+        Format::narrow (values, cells.data(), numSamples);
+    }
+}
+
+template <typename Ring, typename Taps>
+void PsxVerb::processRunWith(Ring ring, const Taps& t, const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples) {
+    // Same network as processScalar, but each statement runs over the whole
+    // run before the next one. updateBlockLimit() keeps runs short enough that
+    // no tap reads a cell written later in the same run (or vice versa), and
+    // runLength() keeps every tap contiguous, so the taps become plain loads.
+    auto tap = [&] (uint32_t offset) {
+        return ring + ((offset + BufferAddress) & spu_buffer_count_mask);
+    };
+
+    const float wall = t.vWALL, iir = t.vIIR;
+    const float comb1 = t.vCOMB1, comb2 = t.vCOMB2, comb3 = t.vCOMB3, comb4 = t.vCOMB4;
+    auto walled = [&] (float in, float wallTap) {
+        return t.hasWall ? in + wallTap * wall : in;
+    };
+
+    // Same and different side reflections feed back on the previous sample,
+    // so they are the only part that has to stay sample by sample
+    auto reflections = [&] {
+        const auto dLS = tap(t.dLSAME);
+        const auto dRS = tap(t.dRSAME);
+        const auto dLD = tap(t.dLDIFF);
+        const auto dRD = tap(t.dRDIFF);
+        auto LS = tap(t.mLSAME);
+        auto RS = tap(t.mRSAME);
+        auto LD = tap(t.mLDIFF);
+        auto RD = tap(t.mRDIFF);
+        const auto LSprev = tap(t.mLSAME - 1);
+        const auto RSprev = tap(t.mRSAME - 1);
+        const auto LDprev = tap(t.mLDIFF - 1);
+        const auto RDprev = tap(t.mRDIFF - 1);
+
+        if (!block_paired) {
+            for (int i = 0; i < numSamples; i++) {
+                LS[i] = (walled(Lin[i], dLS[i]) - LSprev[i]) * iir + LSprev[i];
+                RS[i] = (walled(Rin[i], dRS[i]) - RSprev[i]) * iir + RSprev[i];
+                LD[i] = (walled(Lin[i], dRD[i]) - LDprev[i]) * iir + LDprev[i];
+                RD[i] = (walled(Rin[i], dLD[i]) - RDprev[i]) * iir + RDprev[i];
+            }
+            return;
+        }
+
+        // The four IIRs share their coefficient, so they run as the lanes of
+        // one vector { L SAME, R SAME, L DIFF, R DIFF } with each lane's
+        // previous output kept in the register instead of re-read from the ring
+        alignas (16) float lanes[BLOCK_MAX * 4];
+        for (int i = 0; i < numSamples; i++) {
+            lanes[i * 4 + 0] = walled(Lin[i], dLS[i]);
+            lanes[i * 4 + 1] = walled(Rin[i], dRS[i]);
+            lanes[i * 4 + 2] = walled(Lin[i], dRD[i]);
+            lanes[i * 4 + 3] = walled(Rin[i], dLD[i]);
+        }
+
+        const Lanes4 alpha = Lanes4::broadcast(iir);
+        Lanes4 prev = Lanes4::set(LSprev[0], RSprev[0], LDprev[0], RDprev[0]);
+        for (int i = 0; i < numSamples; i++) {
+            prev = (Lanes4::load(lanes + i * 4) - prev) * alpha + prev;
+            prev.store(lanes + i * 4);
+        }
+
+        for (int i = 0; i < numSamples; i++)
+            LS[i] = lanes[i * 4 + 0];
+        for (int i = 0; i < numSamples; i++)
+            RS[i] = lanes[i * 4 + 1];
+        for (int i = 0; i < numSamples; i++)
+            LD[i] = lanes[i * 4 + 2];
+        for (int i = 0; i < numSamples; i++)
+            RD[i] = lanes[i * 4 + 3];
+    };
+
+    // Early echo
+    float widened[4][BLOCK_MAX];
+    auto combs = [&] (float* out, uint32_t m1, uint32_t m2, uint32_t m3, uint32_t m4) {
+        const float* C1 = readRun(tap(m1), numSamples, widened[0]);
+        const float* C2 = t.hasComb2 ? readRun(tap(m2), numSamples, widened[1]) : nullptr;
+        const float* C3 = t.hasComb3 ? readRun(tap(m3), numSamples, widened[2]) : nullptr;
+        const float* C4 = t.hasComb4 ? readRun(tap(m4), numSamples, widened[3]) : nullptr;
+        for (int i = 0; i < numSamples; i++)
+            out[i] = comb1 * C1[i];
+        if (t.hasComb2) {
+            for (int i = 0; i < numSamples; i++)
+                out[i] += comb2 * C2[i];
+        }
+        if (t.hasComb3) {
+            for (int i = 0; i < numSamples; i++)
+                out[i] += comb3 * C3[i];
+        }
+        if (t.hasComb4) {
+            for (int i = 0; i < numSamples; i++)
+                out[i] += comb4 * C4[i];
+        }
+    };
+
+    // Some presets put a comb tap just ahead of a reflection write, in which
+    // case the combs read the whole run before the reflections overwrite it
+    if (block_combs_first) {
+        combs(Lout, t.mLCOMB1, t.mLCOMB2, t.mLCOMB3, t.mLCOMB4);
+        combs(Rout, t.mRCOMB1, t.mRCOMB2, t.mRCOMB3, t.mRCOMB4);
+        reflections();
+    } else {
+        reflections();
+        combs(Lout, t.mLCOMB1, t.mLCOMB2, t.mLCOMB3, t.mLCOMB4);
+        combs(Rout, t.mRCOMB1, t.mRCOMB2, t.mRCOMB3, t.mRCOMB4);
+    }
+
+    // Late reverb APFs, one pass per statement of the scalar version. With a
+    // zero coefficient an APF just stores its input and reads back the delay.
+    // The delay is read again after the write, which may have landed on it.
+    auto apf = [&] (float* out, uint32_t m, uint32_t d, float v, bool active) {
+        const float* r;
+        if (active) {
+            r = readRun(tap(m - d), numSamples, widened[0]);
+            for (int i = 0; i < numSamples; i++)
+                out[i] -= v * r[i];
+        }
+        writeRun(out, numSamples, tap(m));
+        r = readRun(tap(m - d), numSamples, widened[0]);
+        if (active) {
+            for (int i = 0; i < numSamples; i++)
+                out[i] = out[i] * v + r[i];
+        } else {
+            for (int i = 0; i < numSamples; i++)
+                out[i] = r[i];
+        }
+    };
+
+    const float apf1 = t.vAPF1, apf2 = t.vAPF2;
+    apf(Lout, t.mLAPF1, t.dAPF1, apf1, t.hasApf1);
+    apf(Rout, t.mRAPF1, t.dAPF1, apf1, t.hasApf1);
+    apf(Lout, t.mLAPF2, t.dAPF2, apf2, t.hasApf2);
+    apf(Rout, t.mRAPF2, t.dAPF2, apf2, t.hasApf2);
+
+    BufferAddress = (BufferAddress + (uint32_t) numSamples) & spu_buffer_count_mask;
+}
+
+void PsxVerb::processFixedScalar(const float* LinBuffer, const float* RinBuffer, float* LoutBuffer, float* RoutBuffer, int numSamples) {
+    // Same network as processScalar on int16 SPU RAM. Products truncate to
+    // 16 fractional bits, sums stay at 32 bits and saturate on the way out.
+    auto ram = [this] (uint32_t offset) -> int16_t& {
+        return spu_ram[(offset + BufferAddress) & spu_buffer_count_mask];
+    };
+
+    // Skipping what the plan leaves out only drops products that are zero
+    const int32_t wall = fixed.vWALL, iir = fixed.vIIR, iirRest = 32768 - fixed.vIIR;
+    auto reflect = [&] (int16_t in, uint32_t wallTap, uint32_t line) {
+        const int32_t input = plan.wall ? sat16 (in + mul15 (ram(wallTap), wall)) : in;
+        ram(line) = sat16 (mul15 (input, iir) + mul15 (ram(line - 1), iirRest));
+    };
+
+    auto apf = [&] (int16_t out, uint32_t m, uint32_t d, int32_t v, bool active) -> int16_t {
+        if (!active) {
+            ram(m) = out;
+            return ram(m - d);
+        }
+        const int16_t x = sat16 (out - mul15 (v, ram(m - d)));
+        ram(m) = x;
+        return sat16 (mul15 (x, v) + ram(m - d));
+    };
+
+    auto combs = [&] (uint32_t m1, uint32_t m2, uint32_t m3, uint32_t m4) {
+        int32_t sum = mul15 (fixed.vCOMB1, ram(m1));
+        if (plan.comb2)
+            sum += mul15 (fixed.vCOMB2, ram(m2));
+        if (plan.comb3)
+            sum += mul15 (fixed.vCOMB3, ram(m3));
+        if (plan.comb4)
+            sum += mul15 (fixed.vCOMB4, ram(m4));
+        return sat16 (sum);
+    };
+
+    for (int i = 0; i < numSamples; i++) {
+        const int16_t Lin = f2s(LinBuffer[i]);
+        const int16_t Rin = f2s(RinBuffer[i]);
+
+        // Same side reflection
+        reflect(Lin, dLSAME, mLSAME);
+        reflect(Rin, dRSAME, mRSAME);
+
+        // Different side reflection
+        reflect(Lin, dRDIFF, mLDIFF);
+        reflect(Rin, dLDIFF, mRDIFF);
+
+        // Early echo
+        int16_t Lout = combs(mLCOMB1, mLCOMB2, mLCOMB3, mLCOMB4);
+        int16_t Rout = combs(mRCOMB1, mRCOMB2, mRCOMB3, mRCOMB4);
+
+        // Late reverb APF1
+        Lout = apf(Lout, mLAPF1, dAPF1, fixed.vAPF1, plan.apf1);
+        Rout = apf(Rout, mRAPF1, dAPF1, fixed.vAPF1, plan.apf1);
+
+        // Late reverb APF2
+        Lout = apf(Lout, mLAPF2, dAPF2, fixed.vAPF2, plan.apf2);
+        Rout = apf(Rout, mRAPF2, dAPF2, fixed.vAPF2, plan.apf2);
 
         BufferAddress = (BufferAddress + 1) & spu_buffer_count_mask;
 
-        // Output to buffer
-        leftBuffer[i] = (Lout * wet + Lin * dry) * master;
-        rightBuffer[i] = (Rout * wet + Rin * dry) * master;
+        LoutBuffer[i] = s2f(Lout);
+        RoutBuffer[i] = s2f(Rout);
+    }
+}
+
+void PsxVerb::processFixedRun(const float* LinBuffer, const float* RinBuffer, float* LoutBuffer, float* RoutBuffer, int numSamples) {
+    // processRun for the fixed-point engine, in the same pass order so the
+    // same block limit holds. Combs and APFs run eight samples per vector,
+    // with the scalar arithmetic of processFixedScalar for the remainder.
+    auto tap = [this] (uint32_t offset) {
+        return spu_ram + ((offset + BufferAddress) & spu_buffer_count_mask);
+    };
+
+    const int vectorEnd = numSamples & ~7;
+    int16_t Lin[BLOCK_MAX], Rin[BLOCK_MAX];
+    int16_t Lout[BLOCK_MAX], Rout[BLOCK_MAX];
+    for (int i = 0; i < numSamples; i++) {
+        Lin[i] = f2s(LinBuffer[i]);
+        Rin[i] = f2s(RinBuffer[i]);
+    }
+
+    const int32_t wall = fixed.vWALL, iir = fixed.vIIR, iirRest = 32768 - fixed.vIIR;
+    auto walled = [&] (int16_t in, int16_t wallTap) -> int16_t {
+        return plan.wall ? sat16 (in + mul15 (wallTap, wall)) : in;
+    };
+
+    auto reflections = [&] {
+        const int16_t* dLS = tap(dLSAME);
+        const int16_t* dRS = tap(dRSAME);
+        const int16_t* dLD = tap(dLDIFF);
+        const int16_t* dRD = tap(dRDIFF);
+        int16_t* LS = tap(mLSAME);
+        int16_t* RS = tap(mRSAME);
+        int16_t* LD = tap(mLDIFF);
+        int16_t* RD = tap(mRDIFF);
+        const int16_t* LSprev = tap(mLSAME - 1);
+        const int16_t* RSprev = tap(mRSAME - 1);
+        const int16_t* LDprev = tap(mLDIFF - 1);
+        const int16_t* RDprev = tap(mRDIFF - 1);
+
+        auto iirStep = [&] (int32_t input, int32_t prev) {
+            return sat16 (mul15 (input, iir) + mul15 (prev, iirRest));
+        };
+
+        if (!block_paired) {
+            for (int i = 0; i < numSamples; i++) {
+                LS[i] = iirStep (walled (Lin[i], dLS[i]), LSprev[i]);
+                RS[i] = iirStep (walled (Rin[i], dRS[i]), RSprev[i]);
+                LD[i] = iirStep (walled (Lin[i], dRD[i]), LDprev[i]);
+                RD[i] = iirStep (walled (Rin[i], dLD[i]), RDprev[i]);
+            }
+            return;
+        }
+
+        // All wall reads first, then the four recurrences with their previous
+        // outputs carried in registers, as in the float paired layout
+        int16_t inLS[BLOCK_MAX], inRS[BLOCK_MAX], inLD[BLOCK_MAX], inRD[BLOCK_MAX];
+        for (int i = 0; i < numSamples; i++) {
+            inLS[i] = walled (Lin[i], dLS[i]);
+            inRS[i] = walled (Rin[i], dRS[i]);
+            inLD[i] = walled (Lin[i], dRD[i]);
+            inRD[i] = walled (Rin[i], dLD[i]);
+        }
+
+        int16_t prevLS = LSprev[0], prevRS = RSprev[0], prevLD = LDprev[0], prevRD = RDprev[0];
+        for (int i = 0; i < numSamples; i++) {
+            LS[i] = prevLS = iirStep (inLS[i], prevLS);
+            RS[i] = prevRS = iirStep (inRS[i], prevRS);
+            LD[i] = prevLD = iirStep (inLD[i], prevLD);
+            RD[i] = prevRD = iirStep (inRD[i], prevRD);
+        }
+    };
+
+    // Early echo
+    auto combs = [&] (int16_t* out, uint32_t m1, uint32_t m2, uint32_t m3, uint32_t m4) {
+        const int16_t* C1 = tap(m1);
+        const int16_t* C2 = tap(m2);
+        const int16_t* C3 = tap(m3);
+        const int16_t* C4 = tap(m4);
+
+        const Samples8 c1 = Samples8::broadcast(fixed.vCOMB1), c2 = Samples8::broadcast(fixed.vCOMB2);
+        const Samples8 c3 = Samples8::broadcast(fixed.vCOMB3), c4 = Samples8::broadcast(fixed.vCOMB4);
+        for (int i = 0; i < vectorEnd; i += 8) {
+            Wide8 sum = Wide8::product(Samples8::load(C1 + i), c1);
+            if (plan.comb2)
+                sum = sum + Wide8::product(Samples8::load(C2 + i), c2);
+            if (plan.comb3)
+                sum = sum + Wide8::product(Samples8::load(C3 + i), c3);
+            if (plan.comb4)
+                sum = sum + Wide8::product(Samples8::load(C4 + i), c4);
+            sum.saturate().store(out + i);
+        }
+        for (int i = vectorEnd; i < numSamples; i++) {
+            int32_t sum = mul15 (fixed.vCOMB1, C1[i]);
+            if (plan.comb2)
+                sum += mul15 (fixed.vCOMB2, C2[i]);
+            if (plan.comb3)
+                sum += mul15 (fixed.vCOMB3, C3[i]);
+            if (plan.comb4)
+                sum += mul15 (fixed.vCOMB4, C4[i]);
+            out[i] = sat16 (sum);
+        }
+    };
+
+    if (block_combs_first) {
+        combs(Lout, mLCOMB1, mLCOMB2, mLCOMB3, mLCOMB4);
+        combs(Rout, mRCOMB1, mRCOMB2, mRCOMB3, mRCOMB4);
+        reflections();
+    } else {
+        reflections();
+        combs(Lout, mLCOMB1, mLCOMB2, mLCOMB3, mLCOMB4);
+        combs(Rout, mRCOMB1, mRCOMB2, mRCOMB3, mRCOMB4);
     }
+
+    // Late reverb APFs, one pass per statement of the scalar version
+    auto apf = [&] (int16_t* out, uint32_t m, uint32_t d, int16_t v, bool active) {
+        int16_t* w = tap(m);
+        const int16_t* r = tap(m - d);
+        if (!active) {
+            std::copy (out, out + numSamples, w);
+            std::copy (r, r + numSamples, out);
+            return;
+        }
+        const Samples8 coefficient = Samples8::broadcast(v);
+
+        for (int i = 0; i < vectorEnd; i += 8)
+            (Wide8::widen(Samples8::load(out + i)) - Wide8::product(coefficient, Samples8::load(r + i))).saturate().store(out + i);
+        for (int i = vectorEnd; i < numSamples; i++)
+            out[i] = sat16 (out[i] - mul15 (v, r[i]));
+
+        std::copy (out, out + numSamples, w);
+
+        for (int i = 0; i < vectorEnd; i += 8)
+            (Wide8::product(Samples8::load(out + i), coefficient) + Wide8::widen(Samples8::load(r + i))).saturate().store(out + i);
+        for (int i = vectorEnd; i < numSamples; i++)
+            out[i] = sat16 (mul15 (out[i], v) + r[i]);
+    };
+
+    apf(Lout, mLAPF1, dAPF1, fixed.vAPF1, plan.apf1);
+    apf(Rout, mRAPF1, dAPF1, fixed.vAPF1, plan.apf1);
+    apf(Lout, mLAPF2, dAPF2, fixed.vAPF2, plan.apf2);
+    apf(Rout, mRAPF2, dAPF2, fixed.vAPF2, plan.apf2);
+
+    for (int i = 0; i < numSamples; i++) {
+        LoutBuffer[i] = s2f(Lout[i]);
+        RoutBuffer[i] = s2f(Rout[i]);
+    }
+
+    BufferAddress = (BufferAddress + (uint32_t) numSamples) & spu_buffer_count_mask;
+}
+
+namespace
+{
+    // One spu_buffer access of the per-sample loop. Accesses are listed in the
+    // order processScalar makes them within a sample; pass is the order
+    // processRun makes them in, and sequential passes go sample by sample.
+    struct TapAccess
+    {
+        uint32_t offset;
+        bool write;
+        int pass;
+        bool sequential;
+    };
+}
+
+void PsxVerb::updatePlan()
+{
+    plan.comb2 = vCOMB2 != 0.0f;
+    plan.comb3 = vCOMB3 != 0.0f;
+    plan.comb4 = vCOMB4 != 0.0f;
+    plan.wall = vWALL != 0.0f;
+    plan.apf1 = vAPF1 != 0.0f;
+    plan.apf2 = vAPF2 != 0.0f;
+
+    // A delay-less APF with a zero coefficient writes its input and reads
+    // it straight back, so silence in is silence out
+    plan.inert = vCOMB1 == 0.0f && !plan.comb2 && !plan.comb3 && !plan.comb4
+        && !plan.apf1 && dAPF1 == 0 && !plan.apf2 && dAPF2 == 0;
+
+    // Four reflections, two sides of combs and two of each APF
+    const int combs = 1 + plan.comb2 + plan.comb3 + plan.comb4;
+    plan.accesses = 4 * (plan.wall ? 3 : 2) + 2 * combs + 2 * ((plan.apf1 ? 3 : 2) + (plan.apf2 ? 3 : 2));
+}
+
+void PsxVerb::updateBlockLimit()
+{
+    // Reflections run either as one sequential pass or as paired lanes, and
+    // the combs go either before or after them, whichever allows longer runs
+    auto limitFor = [this] (bool combsFirst, bool paired) {
+        const int combsL = combsFirst ? 0 : 10;
+        const int combsR = combsL + 1;
+
+        TapAccess access[32];
+        int count = 0;
+        // Taps the plan skips are never touched, so they can't clash
+        auto add = [&] (uint32_t offset, bool write, int pass, bool sequential, bool used = true) {
+            if (used)
+                access[count++] = { offset, write, pass, sequential };
+        };
+
+        if (paired) {
+            // Wall reads and line writes each get a pass of their own. The
+            // previous-sample reads come from the lane registers, which only
+            // holds while no other write lands on a line's cells.
+            add(dLSAME, false, 2, false, plan.wall);
+            add(mLSAME, true, 6, false);
+            add(dRSAME, false, 3, false, plan.wall);
+            add(mRSAME, true, 7, false);
+            add(dRDIFF, false, 4, false, plan.wall);
+            add(mLDIFF, true, 8, false);
+            add(dLDIFF, false, 5, false, plan.wall);
+            add(mRDIFF, true, 9, false);
+        } else {
+            add(dLSAME, false, 2, true, plan.wall);
+            add(mLSAME - 1, false, 2, true);
+            add(mLSAME, true, 2, true);
+            add(dRSAME, false, 2, true, plan.wall);
+            add(mRSAME - 1, false, 2, true);
+            add(mRSAME, true, 2, true);
+            add(dRDIFF, false, 2, true, plan.wall);
+            add(mLDIFF - 1, false, 2, true);
+            add(mLDIFF, true, 2, true);
+            add(dLDIFF, false, 2, true, plan.wall);
+            add(mRDIFF - 1, false, 2, true);
+            add(mRDIFF, true, 2, true);
+        }
+
+        add(mLCOMB1, false, combsL, false);
+        add(mLCOMB2, false, combsL, false, plan.comb2);
+        add(mLCOMB3, false, combsL, false, plan.comb3);
+        add(mLCOMB4, false, combsL, false, plan.comb4);
+        add(mRCOMB1, false, combsR, false);
+        add(mRCOMB2, false, combsR, false, plan.comb2);
+        add(mRCOMB3, false, combsR, false, plan.comb3);
+        add(mRCOMB4, false, combsR, false, plan.comb4);
+        add(mLAPF1 - dAPF1, false, 12, false, plan.apf1);
+        add(mLAPF1, true, 13, false);
+        add(mLAPF1 - dAPF1, false, 14, false);
+        add(mRAPF1 - dAPF1, false, 15, false, plan.apf1);
+        add(mRAPF1, true, 16, false);
+        add(mRAPF1 - dAPF1, false, 17, false);
+        add(mLAPF2 - dAPF2, false, 18, false, plan.apf2);
+        add(mLAPF2, true, 19, false);
+        add(mLAPF2 - dAPF2, false, 20, false);
+        add(mRAPF2 - dAPF2, false, 21, false, plan.apf2);
+        add(mRAPF2, true, 22, false);
+        add(mRAPF2 - dAPF2, false, 23, false);
+
+        if (paired) {
+            const uint32_t lineOffsets[] = { mLSAME, mRSAME, mLDIFF, mRDIFF };
+            for (int l = 0; l < 4; l++) {
+                for (int y = 0; y < count; y++) {
+                    if (!access[y].write || (access[y].offset == lineOffsets[l] && access[y].pass == 6 + l))
+                        continue;
+                    const uint32_t at = access[y].offset & spu_buffer_count_mask;
+                    if (at == (lineOffsets[l] & spu_buffer_count_mask) || at == ((lineOffsets[l] - 1) & spu_buffer_count_mask))
+                        return 0;
+                }
+            }
+        }
+
+        if (!paired) {
+            num_block_taps = 0;
+            for (int x = 0; x < count; x++) {
+                if (std::find (block_taps, block_taps + num_block_taps, access[x].offset) == block_taps + num_block_taps)
+                    block_taps[num_block_taps++] = access[x].offset;
+            }
+        }
+
+        // Whenever two accesses hit the same cell within a run, the block order
+        // must agree with the per-sample order; otherwise runs have to be shorter
+        // than the distance between them.
+        int limit = std::min (BLOCK_MAX, (int) (spu_buffer_count / 2));
+
+        for (int x = 0; x < count; x++) {
+            for (int y = 0; y < count; y++) {
+                const TapAccess& a = access[x];
+                const TapAccess& b = access[y];
+                if (x == y || !(a.write || b.write))
+                    continue;
+
+                // a at sample ia and b at sample ib share a cell when ia - ib == off (mod ring size)
+                const int off = (int) ((b.offset - a.offset) & spu_buffer_count_mask);
+                for (int delta : { off, off - (int) spu_buffer_count }) {
+                    if (std::abs (delta) >= limit)
+                        continue;
+
+                    const int ib = std::max (0, -delta);
+                    const int ia = ib + delta;
+
+                    const bool scalarFirst = ia != ib ? ia < ib : x < y;
+                    bool blockFirst;
+                    if (a.pass != b.pass)
+                        blockFirst = a.pass < b.pass;
+                    else if (a.sequential)
+                        blockFirst = ia != ib ? ia < ib : x < y;
+                    else
+                        blockFirst = ia < ib;
+
+                    if (scalarFirst != blockFirst)
+                        limit = std::abs (delta);
+                }
+            }
+        }
+
+        return limit;
+    };
+
+    // Taps are collected from the sequential layout, which touches every cell
+    // the paired one does. The 16-bit engines round every write, so their
+    // IIRs have to read the previous output back from the ring rather than
+    // carry it in a lane.
+    const bool canPair = active_engine == Engine::Float;
+    block_limit = 0;
+    for (bool paired : { false, true }) {
+        if (paired && !canPair)
+            continue;
+        for (bool combsFirst : { false, true }) {
+            const int limit = limitFor (combsFirst, paired);
+            if (limit >= block_limit) {
+                block_limit = limit;
+                block_combs_first = combsFirst;
+                block_paired = paired;
+            }
+        }
+    }
+}
+
+namespace
+{
+    // One ring access of the per-sample loop, in processScalar's order. A
+    // write names the line it fills, a read its index into line_reads; pass
+    // is the processLines() pass that makes it.
+    struct LineAccess
+    {
+        uint32_t offset;
+        int line;
+        int read;
+        int pass;
+    };
+}
+
+void PsxVerb::updateLines()
+{
+    LineAccess access[NUM_LINES + NUM_LINE_READS];
+    int count = 0;
+    auto write = [&] (uint32_t offset, int line, int pass) {
+        access[count++] = { offset, line, -1, pass };
+    };
+    auto read = [&] (uint32_t offset, int index, int pass) {
+        access[count++] = { offset, -1, index, pass };
+    };
+
+    // The reflections are one pass that goes sample by sample
+    read(dLSAME, 0, 0);
+    read(mLSAME - 1, 1, 0);
+    write(mLSAME, 0, 0);
+    read(dRSAME, 2, 0);
+    read(mRSAME - 1, 3, 0);
+    write(mRSAME, 1, 0);
+    read(dRDIFF, 4, 0);
+    read(mLDIFF - 1, 5, 0);
+    write(mLDIFF, 2, 0);
+    read(dLDIFF, 6, 0);
+    read(mRDIFF - 1, 7, 0);
+    write(mRDIFF, 3, 0);
+
+    const uint32_t combs[] = { mLCOMB1, mLCOMB2, mLCOMB3, mLCOMB4, mRCOMB1, mRCOMB2, mRCOMB3, mRCOMB4 };
+    for (int c = 0; c < 8; c++)
+        read(combs[c], 8 + c, 1 + c / 4);
+
+    const uint32_t apfs[][2] = { { mLAPF1, dAPF1 }, { mRAPF1, dAPF1 }, { mLAPF2, dAPF2 }, { mRAPF2, dAPF2 } };
+    for (int a = 0; a < 4; a++) {
+        read(apfs[a][0] - apfs[a][1], 16 + 2 * a, 3 + 3 * a);
+        write(apfs[a][0], 4 + a, 4 + 3 * a);
+        read(apfs[a][0] - apfs[a][1], 17 + 2 * a, 5 + 3 * a);
+    }
+
+    // Reads the plan skips neither size a line nor limit a run
+    auto used = [this] (int index) {
+        if (index < 8)
+            return index % 2 == 1 || plan.wall;
+        if (index < 16) {
+            const int comb = (index - 8) % 4;
+            return comb == 0 || (comb == 1 && plan.comb2) || (comb == 2 && plan.comb3) || (comb == 3 && plan.comb4);
+        }
+        // In and out reads of L/R APF1, then of L/R APF2
+        const int apf = index - 16;
+        return apf % 2 == 1 || (apf < 4 ? plan.apf1 : plan.apf2);
+    };
+
+    // A read sees whatever was last written to its cell: by the write with
+    // the shortest delay to it, the later of two writes at the same delay,
+    // or a whole ring ago for a write that comes after it in the same sample.
+    // Runs are limited like block_limit, but only a read made before its
+    // line is written in the same run matters now.
+    uint32_t longest[NUM_LINES] = {};
+    lines_block_limit = BLOCK_MAX;
+    for (int x = 0; x < count; x++) {
+        const int r = access[x].read;
+        if (r < 0)
+            continue;
+
+        int source = -1;
+        uint32_t sourceDelay = 0;
+        for (int y = 0; y < count; y++) {
+            if (access[y].line < 0)
+                continue;
+            uint32_t delay = (access[y].offset - access[x].offset) & spu_buffer_count_mask;
+            if (delay == 0 && y > x)
+                delay = spu_buffer_count;
+            if (source < 0 || delay <= sourceDelay) {
+                source = y;
+                sourceDelay = delay;
+            }
+        }
+
+        if (!used(r)) {
+            line_reads[r] = { -1, 0 };
+            continue;
+        }
+        line_reads[r] = { access[source].line, sourceDelay };
+        longest[access[source].line] = std::max (longest[access[source].line], sourceDelay);
+        if (access[source].pass > access[x].pass)
+            lines_block_limit = std::min (lines_block_limit, (int) sourceDelay);
+    }
+
+    // The reflections can run as paired lanes, as in processRun, when each
+    // line's previous sample is its own and no wall read needs a reflection
+    // written earlier in the same run
+    lines_paired = true;
+    for (int k = 0; k < 4; k++) {
+        const LineRead& prev = line_reads[2 * k + 1];
+        const LineRead& wall = line_reads[2 * k];
+        if (prev.line != k || prev.delay != 1)
+            lines_paired = false;
+        if (wall.line >= 0 && wall.line < 4 && (int) wall.delay < lines_block_limit)
+            lines_paired = false;
+    }
+
+    // Room for the longest delay plus a whole run, so a run's writes never
+    // land on a cell one of its reads still needs
+    lines_cells = 0;
+    lines_shortest = UINT32_MAX;
+    lines_period = 0;
+    for (int l = 0; l < NUM_LINES; l++) {
+        lines[l].length = ceilpower2 (longest[l] + BLOCK_MAX);
+        lines[l].data = spu_buffer != nullptr ? spu_buffer + lines_cells : nullptr;
+        lines_cells += 2 * lines[l].length;
+        lines_shortest = std::min (lines_shortest, lines[l].length);
+        lines_period = std::max (lines_period, lines[l].length);
+    }
+
+    BufferAddress &= lines_period - 1;
+    spu_buffer_used = std::max (spu_buffer_used, lines_cells);
+}
+
+namespace
+{
+    // Where each extra speaker's taps start looking back from the combs', in
+    // ms. Spread out and none a simple multiple of another, so no two
+    // speakers repeat each other's echoes.
+    constexpr float speaker_delay_ms[PsxVerb::MAX_SPEAKERS] = {
+        7.1f, 11.3f, 17.9f, 23.7f, 31.1f, 37.3f, 43.9f, 53.3f,
+        59.9f, 67.1f, 73.7f, 83.9f, 89.3f, 97.1f, 103.7f, 109.9f,
+    };
+}
+
+void PsxVerb::updateSpeakerTaps()
+{
+    const uint32_t mask = spu_buffer_count_mask;
+    const uint32_t written[] = { mLSAME, mRSAME, mLDIFF, mRDIFF, mLAPF1, mRAPF1, mLAPF2, mRAPF2 };
+    const uint32_t combsL[] = { mLCOMB1, mLCOMB2, mLCOMB3, mLCOMB4 };
+    const uint32_t combsR[] = { mRCOMB1, mRCOMB2, mRCOMB3, mRCOMB4 };
+    const float gains[] = { vCOMB1, vCOMB2, vCOMB3, vCOMB4 };
+
+    int extra = 0;
+    for (int c = 0; c < num_speakers; c++) {
+        SpeakerState& s = speaker_state[c];
+        s.num_taps = 0;
+        if (!speakers[c].wet || s.main >= 0)
+            continue;
+
+        // The early echo of the sides it leans to, at constant power
+        const float pan = speakers[c].pan;
+        const float left = (1.0f - pan) / 2.0f, right = (1.0f + pan) / 2.0f;
+        const float norm = 1.0f / std::sqrt (left * left + right * right);
+        uint32_t combs[MAX_SPEAKER_TAPS];
+        float combGains[MAX_SPEAKER_TAPS];
+        int numTaps = 0;
+        for (int n = 0; n < 4; n++) {
+            if (gains[n] == 0.0f)
+                continue;
+            if (left > 0.0f) {
+                combs[numTaps] = combsL[n];
+                combGains[numTaps++] = gains[n] * left * norm;
+            }
+            if (right > 0.0f) {
+                combs[numTaps] = combsR[n];
+                combGains[numTaps++] = gains[n] * right * norm;
+            }
+        }
+
+        // From its own delay, step further back past every line that would
+        // reach a tap within a run: one starting up to a run below it
+        uint32_t delay = std::max (1u, (uint32_t) (speaker_delay_ms[extra++] * network_rate / 1000.0f));
+        bool placed = false;
+        for (int attempt = 0; attempt < 256 && delay < spu_buffer_count && !placed; attempt++) {
+            uint32_t skip = 0;
+            for (int k = 0; k < numTaps; k++) {
+                for (uint32_t line : written) {
+                    const uint32_t below = ((combs[k] - delay) - line) & mask;
+                    if (below < (uint32_t) BLOCK_MAX)
+                        skip = std::max (skip, below + 1);
+                }
+            }
+            placed = skip == 0;
+            delay += skip;
+        }
+        if (!placed)
+            continue;
+
+        for (int k = 0; k < numTaps; k++) {
+            s.taps[k] = (combs[k] - delay) & mask;
+            s.gains[k] = combGains[k];
+        }
+        s.num_taps = numTaps;
+    }
+}
+
+int PsxVerb::linesRunLength(int numSamples) const
+{
+    // The shortest line wraps first, the others' lengths are multiples of it
+    const int untilWrap = (int) (lines_shortest - (BufferAddress & (lines_shortest - 1)));
+    return std::min ({ numSamples, lines_block_limit, untilWrap });
+}
+
+void PsxVerb::processLines(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples) {
+    // processRun on the Lines layout. No run crosses the end of a line, so
+    // every read is contiguous from where its line was delay samples ago
+    // (in the mirror when that's in this lap) and every write goes to both
+    // copies.
+    auto from = [this] (int read) -> const float* {
+        const Line& line = lines[line_reads[read].line];
+        return line.data + (BufferAddress & (line.length - 1)) + line.length - line_reads[read].delay;
+    };
+    auto to = [this] (int line) {
+        return lines[line].data + (BufferAddress & (lines[line].length - 1));
+    };
+
+    const float wall = vWALL, iir = vIIR;
+    const bool hasWall = plan.wall;
+    const float* in[4] = { Lin, Rin, Lin, Rin };
+    const float* walls[4];
+    const float* prevs[4];
+    float* outs[4];
+    uint32_t mirrors[4];
+    for (int k = 0; k < 4; k++) {
+        walls[k] = hasWall ? from(2 * k) : nullptr;
+        prevs[k] = from(2 * k + 1);
+        outs[k] = to(k);
+        mirrors[k] = lines[k].length;
+    }
+
+    // Same and different side reflections, sample by sample as any of them
+    // may read what another wrote earlier in the same sample
+    if (!lines_paired) {
+        for (int i = 0; i < numSamples; i++) {
+            for (int k = 0; k < 4; k++) {
+                const float input = hasWall ? in[k][i] + walls[k][i] * wall : in[k][i];
+                const float y = (input - prevs[k][i]) * iir + prevs[k][i];
+                outs[k][i] = y;
+                outs[k][(size_t) i + mirrors[k]] = y;
+            }
+        }
+    } else {
+        alignas (16) float lanes[BLOCK_MAX * 4];
+        if (hasWall) {
+            for (int i = 0; i < numSamples; i++) {
+                lanes[i * 4 + 0] = Lin[i] + walls[0][i] * wall;
+                lanes[i * 4 + 1] = Rin[i] + walls[1][i] * wall;
+                lanes[i * 4 + 2] = Lin[i] + walls[2][i] * wall;
+                lanes[i * 4 + 3] = Rin[i] + walls[3][i] * wall;
+            }
+        } else {
+            for (int i = 0; i < numSamples; i++)
+                Lanes4::set(Lin[i], Rin[i], Lin[i], Rin[i]).store(lanes + i * 4);
+        }
+
+        const Lanes4 alpha = Lanes4::broadcast(iir);
+        Lanes4 prev = Lanes4::set(prevs[0][0], prevs[1][0], prevs[2][0], prevs[3][0]);
+        for (int i = 0; i < numSamples; i++) {
+            prev = (Lanes4::load(lanes + i * 4) - prev) * alpha + prev;
+            prev.store(lanes + i * 4);
+        }
+
+        for (int k = 0; k < 4; k++) {
+            for (int i = 0; i < numSamples; i++)
+                outs[k][i] = outs[k][(size_t) i + mirrors[k]] = lanes[i * 4 + k];
+        }
+    }
+
+    // Early echo
+    const float comb1 = vCOMB1, comb2 = vCOMB2, comb3 = vCOMB3, comb4 = vCOMB4;
+    auto combs = [&] (float* out, int first) {
+        const float* C1 = from(first);
+        for (int i = 0; i < numSamples; i++)
+            out[i] = comb1 * C1[i];
+        if (plan.comb2) {
+            const float* C2 = from(first + 1);
+            for (int i = 0; i < numSamples; i++)
+                out[i] += comb2 * C2[i];
+        }
+        if (plan.comb3) {
+            const float* C3 = from(first + 2);
+            for (int i = 0; i < numSamples; i++)
+                out[i] += comb3 * C3[i];
+        }
+        if (plan.comb4) {
+            const float* C4 = from(first + 3);
+            for (int i = 0; i < numSamples; i++)
+                out[i] += comb4 * C4[i];
+        }
+    };
+    combs(Lout, 8);
+    combs(Rout, 12);
+
+    // Late reverb APFs
+    auto apf = [&] (float* out, int index, float v, bool active) {
+        float* w = to(4 + index);
+        const uint32_t mirror = lines[4 + index].length;
+        if (active) {
+            const float* r = from(16 + 2 * index);
+            for (int i = 0; i < numSamples; i++)
+                out[i] -= v * r[i];
+        }
+        for (int i = 0; i < numSamples; i++)
+            w[i] = w[(size_t) i + mirror] = out[i];
+
+        const float* r = from(17 + 2 * index);
+        if (active) {
+            for (int i = 0; i < numSamples; i++)
+                out[i] = out[i] * v + r[i];
+        } else {
+            std::copy (r, r + numSamples, out);
+        }
+    };
+
+    const float apf1 = vAPF1, apf2 = vAPF2;
+    apf(Lout, 0, apf1, plan.apf1);
+    apf(Rout, 1, apf1, plan.apf1);
+    apf(Lout, 2, apf2, plan.apf2);
+    apf(Rout, 3, apf2, plan.apf2);
+
+    BufferAddress = (BufferAddress + (uint32_t) numSamples) & (lines_period - 1);
 }
 
 void PsxVerb::setPreset(int presetIndex) {
+    // Before init() there are no taps to load, it picks the preset up itself
+    if (spu_buffer_capacity == 0) {
+        if (presetIndex < NUM_PRESETS)
+            preset_index = presetIndex;
+        return;
+    }
+
     if (presetIndex != preset_index) {
         loadPreset(presetIndex);
     }
 }
 
+void PsxVerb::startClearing() {
+    clear_position = 0;
+    clear_end = spu_buffer_used;
+    BufferAddress = 0;
+
+    if (resampled) {
+        decimator.reset();
+        interpolator.reset();
+        std::fill (wet_fifo_l.begin(), wet_fifo_l.end(), 0.0f);
+        std::fill (wet_fifo_r.begin(), wet_fifo_r.end(), 0.0f);
+        wet_fifo_fill = wet_fifo_primed;
+    }
+}
+
+bool PsxVerb::clearSome(uint32_t maxSamples) {
+    const uint32_t count = std::min (maxSamples, clear_end - clear_position);
+    if (active_engine == Engine::Fixed)
+        std::fill (spu_ram + clear_position, spu_ram + clear_position + count, (int16_t) 0);
+    else if (spu_half != nullptr)
+        std::fill (spu_half + clear_position, spu_half + clear_position + count, (uint16_t) 0);
+    else
+        std::fill (spu_buffer + clear_position, spu_buffer + clear_position + count, 0.0f);
+    clear_position += count;
+
+    if (clear_position < clear_end)
+        return false;
+
+    // Everything past the current window, or the lines, was zero already
+    spu_buffer_used = active_layout == Layout::Lines ? lines_cells : spu_buffer_count;
+    return true;
+}
+
+void PsxVerb::setMaxSampleRate(float maxSampleRate) {
+    max_rate = maxSampleRate;
+}
+
+void PsxVerb::setNativeRate(bool shouldRunNative) {
+    native_rate = shouldRunNative;
+}
+
+void PsxVerb::setEngine(Engine newEngine) {
+    engine = newEngine;
+}
+
+void PsxVerb::setLayout(Layout newLayout) {
+    layout = newLayout;
+}
+
+void PsxVerb::setSpeakers(const Speaker* newSpeakers, int count) {
+    num_speakers = std::clamp (count, 0, MAX_SPEAKERS);
+    std::copy (newSpeakers, newSpeakers + num_speakers, speakers);
+
+    // Each side of the fold is scaled down to at most one channel's worth,
+    // so a plain stereo pair goes in exactly as process() takes it
+    float sumL = 0.0f, sumR = 0.0f;
+    for (int c = 0; c < num_speakers; c++) {
+        if (speakers[c].wet) {
+            sumL += (1.0f - speakers[c].pan) / 2.0f;
+            sumR += (1.0f + speakers[c].pan) / 2.0f;
+        }
+    }
+
+    bool haveLeft = false, haveRight = false;
+    for (int c = 0; c < num_speakers; c++) {
+        SpeakerState& s = speaker_state[c];
+        s = {};
+        s.main = -1;
+        if (!speakers[c].wet)
+            continue;
+
+        const float pan = speakers[c].pan;
+        s.foldL = (1.0f - pan) / 2.0f / std::max (1.0f, sumL);
+        s.foldR = (1.0f + pan) / 2.0f / std::max (1.0f, sumR);
+        if (pan < 0.0f && !haveLeft) {
+            s.main = 0;
+            haveLeft = true;
+        } else if (pan > 0.0f && !haveRight) {
+            s.main = 1;
+            haveRight = true;
+        }
+    }
+}
+
 void PsxVerb::setWetGain(float newWet) {
-    wet = newWet;
+    wet = wet_target = newWet;
+    wet_step = 0.0f;
 }
 
 void PsxVerb::setDryGain(float newDry) {
-    dry = newDry;
+    dry = dry_target = newDry;
+    dry_step = 0.0f;
+}
+
+void PsxVerb::setGains(float newWet, float newDry, int rampSamples) {
+    if (rampSamples <= 0) {
+        setWetGain(newWet);
+        setDryGain(newDry);
+        ramp_remaining = 0;
+        return;
+    }
+
+    wet_target = newWet;
+    dry_target = newDry;
+    wet_step = (newWet - wet) / (float) rampSamples;
+    dry_step = (newDry - dry) / (float) rampSamples;
+    ramp_remaining = rampSamples;
+}
+
+bool PsxVerb::nextGains(float* wetGains, float* dryGains, int numSamples) {
+    if (ramp_remaining == 0)
+        return false;
+
+    for (int i = 0; i < numSamples; i++) {
+        if (ramp_remaining > 0) {
+            // The last step lands on the target exactly
+            if (--ramp_remaining == 0) {
+                wet = wet_target;
+                dry = dry_target;
+            } else {
+                wet += wet_step;
+                dry += dry_step;
+            }
+        }
+        wetGains[i] = wet;
+        dryGains[i] = dry;
+    }
+    return true;
 }
 
 void PsxVerb::setMasterGain(float gain) {
@@ -114,14 +1690,14 @@ void PsxVerb::loadPreset(int presetIndex) {
         return;
     }
 
-    float stretch_factor = rate / SPU_REV_RATE;
+    float stretch_factor = network_rate / SPU_REV_RATE;
 
     PsxVerbPreset *preset = (PsxVerbPreset *)&presets[presetIndex];
 
     dAPF1   = (uint32_t)((preset->dAPF1 << 2) * stretch_factor);
     dAPF2   = (uint32_t)((preset->dAPF2 << 2) * stretch_factor);
     // correct 22050 Hz IIR alpha to our actual rate
-    vIIR    = fc2alpha(alpha2fc(s2f(preset->vIIR), SPU_REV_RATE), rate);
+    vIIR    = fc2alpha(alpha2fc(s2f(preset->vIIR), SPU_REV_RATE), network_rate);
     vCOMB1  = s2f(preset->vCOMB1);
     vCOMB2  = s2f(preset->vCOMB2);
     vCOMB3  = s2f(preset->vCOMB3);
@@ -152,79 +1728,203 @@ void PsxVerb::loadPreset(int presetIndex) {
     vLIN    = s2f(preset->vLIN);
     vRIN    = s2f(preset->vRIN);
 
-    memset(spu_buffer, 0, spu_buffer_count * sizeof(float));
+    // Only use as much of the ring as the preset needs, so the small rooms
+    // stay in cache. The window is a power of two for masking, and never
+    // narrower than the furthest tap.
+    const uint32_t furthest = std::max ({ dAPF1, dAPF2, mLSAME, mRSAME, mLCOMB1, mRCOMB1, mLCOMB2, mRCOMB2,
+        dLSAME, dRSAME, mLDIFF, mRDIFF, mLCOMB3, mRCOMB3, mLCOMB4, mRCOMB4,
+        dLDIFF, dRDIFF, mLAPF1, mRAPF1, mLAPF2, mRAPF2 });
+    const uint32_t required = (uint32_t) ceil (preset_memory[presetIndex] / 2 * stretch_factor);
+    spu_buffer_count = std::min (ceilpower2 (std::max (required, furthest + 1)), spu_buffer_capacity);
+    spu_buffer_count_mask = spu_buffer_count - 1;
+    if (active_layout == Layout::Shared) {
+        spu_buffer_used = std::max (spu_buffer_used, spu_buffer_count);
+        BufferAddress &= spu_buffer_count_mask;
+    }
+
+    // A whole window at the host rate, plus whatever the resamplers hold
+    quiet_limit = (int) std::ceil (spu_buffer_count * (rate / network_rate)) + (resampled ? wet_fifo_primed : 0);
+
+    // The fixed-point engine takes the registers as they are, only the IIR
+    // needs correcting when the network doesn't run at the SPU rate
+    fixed.vIIR   = network_rate == SPU_REV_RATE ? preset->vIIR : f2s(vIIR);
+    fixed.vCOMB1 = preset->vCOMB1;
+    fixed.vCOMB2 = preset->vCOMB2;
+    fixed.vCOMB3 = preset->vCOMB3;
+    fixed.vCOMB4 = preset->vCOMB4;
+    fixed.vWALL  = preset->vWALL;
+    fixed.vAPF1  = preset->vAPF1;
+    fixed.vAPF2  = preset->vAPF2;
+
+    updatePlan();
+    updateBlockLimit();
+    if (active_layout == Layout::Lines)
+        updateLines();
+    if (num_speakers > 0)
+        updateSpeakerTaps();
+
     preset_index = presetIndex;
+    selectKernels();
 }
 
-const uint16_t PsxVerb::presets[NUM_PRESETS][0x20] = {
-    {
-        /* Name: Room, SPU mem required: 0x26C0 */
-        0x007D, 0x005B, 0x6D80, 0x54B8, 0xBED0, 0x0000, 0x0000, 0xBA80,
-        0x5800, 0x5300, 0x04D6, 0x0333, 0x03F0, 0x0227, 0x0374, 0x01EF,
-        0x0334, 0x01B5, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-        0x0000, 0x0000, 0x01B4, 0x0136, 0x00B8, 0x005C, 0x8000, 0x8000,
-    },
-    {
-        /* Name: Studio Small, SPU mem required: 0x1F40 */
-        0x0033, 0x0025, 0x70F0, 0x4FA8, 0xBCE0, 0x4410, 0xC0F0, 0x9C00,
-        0x5280, 0x4EC0, 0x03E4, 0x031B, 0x03A4, 0x02AF, 0x0372, 0x0266,
-        0x031C, 0x025D, 0x025C, 0x018E, 0x022F, 0x0135, 0x01D2, 0x00B7,
-        0x018F, 0x00B5, 0x00B4, 0x0080, 0x004C, 0x0026, 0x8000, 0x8000,
-    },
-    {
-        /* Name: Studio Medium, SPU mem required: 0x4840 */
-        0x00B1, 0x007F, 0x70F0, 0x4FA8, 0xBCE0, 0x4510, 0xBEF0, 0xB4C0,
-        0x5280, 0x4EC0, 0x0904, 0x076B, 0x0824, 0x065F, 0x07A2, 0x0616,
-        0x076C, 0x05ED, 0x05EC, 0x042E, 0x050F, 0x0305, 0x0462, 0x02B7,
-        0x042F, 0x0265, 0x0264, 0x01B2, 0x0100, 0x0080, 0x8000, 0x8000,
-    },
-    {
-        /* Name: Studio Large, SPU mem required: 0x6FE0*/
-        0x00E3, 0x00A9, 0x6F60, 0x4FA8, 0xBCE0, 0x4510, 0xBEF0, 0xA680,
-        0x5680, 0x52C0, 0x0DFB, 0x0B58, 0x0D09, 0x0A3C, 0x0BD9, 0x0973,
-        0x0B59, 0x08DA, 0x08D9, 0x05E9, 0x07EC, 0x04B0, 0x06EF, 0x03D2,
-        0x05EA, 0x031D, 0x031C, 0x0238, 0x0154, 0x00AA, 0x8000, 0x8000,
-    },
-    {
-        /* Name: Hall, SPU mem required: 0xADE0 */
-        0x01A5, 0x0139, 0x6000, 0x5000, 0x4C00, 0xB800, 0xBC00, 0xC000,
-        0x6000, 0x5C00, 0x15BA, 0x11BB, 0x14C2, 0x10BD, 0x11BC, 0x0DC1,
-        0x11C0, 0x0DC3, 0x0DC0, 0x09C1, 0x0BC4, 0x07C1, 0x0A00, 0x06CD,
-        0x09C2, 0x05C1, 0x05C0, 0x041A, 0x0274, 0x013A, 0x8000, 0x8000,
-    },
-    {
-        /* Name: Half Echo, SPU mem required: 0x3C00 */
-        0x0017, 0x0013, 0x70F0, 0x4FA8, 0xBCE0, 0x4510, 0xBEF0, 0x8500,
-        0x5F80, 0x54C0, 0x0371, 0x02AF, 0x02E5, 0x01DF, 0x02B0, 0x01D7,
-        0x0358, 0x026A, 0x01D6, 0x011E, 0x012D, 0x00B1, 0x011F, 0x0059,
-        0x01A0, 0x00E3, 0x0058, 0x0040, 0x0028, 0x0014, 0x8000, 0x8000,
-    },
-    {
-        /* Name: Space Echo, SPU mem required: 0xF6C0 */
-        0x033D, 0x0231, 0x7E00, 0x5000, 0xB400, 0xB000, 0x4C00, 0xB000,
-        0x6000, 0x5400, 0x1ED6, 0x1A31, 0x1D14, 0x183B, 0x1BC2, 0x16B2,
-        0x1A32, 0x15EF, 0x15EE, 0x1055, 0x1334, 0x0F2D, 0x11F6, 0x0C5D,
-        0x1056, 0x0AE1, 0x0AE0, 0x07A2, 0x0464, 0x0232, 0x8000, 0x8000,
-    },
-    {
-        /* Name: Chaos Echo, SPU mem required: 0x18040 */
-        0x0001, 0x0001, 0x7FFF, 0x7FFF, 0x0000, 0x0000, 0x0000, 0x8100,
-        0x0000, 0x0000, 0x1FFF, 0x0FFF, 0x1005, 0x0005, 0x0000, 0x0000,
-        0x1005, 0x0005, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-        0x0000, 0x0000, 0x1004, 0x1002, 0x0004, 0x0002, 0x8000, 0x8000,
-    },
-    {
-        /* Name: Delay, SPU mem required: 0x18040 */
-        0x0001, 0x0001, 0x7FFF, 0x7FFF, 0x0000, 0x0000, 0x0000, 0x0000,
-        0x0000, 0x0000, 0x1FFF, 0x0FFF, 0x1005, 0x0005, 0x0000, 0x0000,
-        0x1005, 0x0005, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-        0x0000, 0x0000, 0x1004, 0x1002, 0x0004, 0x0002, 0x8000, 0x8000,
-    },
-    {
-        /* Name: Off, SPU mem required: 0x10 */
-        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
-        0x0000, 0x0000, 0x0001, 0x0001, 0x0001, 0x0001, 0x0001, 0x0001,
-        0x0000, 0x0000, 0x0001, 0x0001, 0x0001, 0x0001, 0x0001, 0x0001,
-        0x0000, 0x0000, 0x0001, 0x0001, 0x0001, 0x0001, 0x0000, 0x0000,
-    }, 
-};
\ No newline at end of file
+namespace
+{
+    constexpr uint16_t spu_presets[][0x20] = {
+        {
+            /* Name: Room, SPU mem required: 0x26C0 */
+            0x007D, 0x005B, 0x6D80, 0x54B8, 0xBED0, 0x0000, 0x0000, 0xBA80,
+            0x5800, 0x5300, 0x04D6, 0x0333, 0x03F0, 0x0227, 0x0374, 0x01EF,
+            0x0334, 0x01B5, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+            0x0000, 0x0000, 0x01B4, 0x0136, 0x00B8, 0x005C, 0x8000, 0x8000,
+        },
+        {
+            /* Name: Studio Small, SPU mem required: 0x1F40 */
+            0x0033, 0x0025, 0x70F0, 0x4FA8, 0xBCE0, 0x4410, 0xC0F0, 0x9C00,
+            0x5280, 0x4EC0, 0x03E4, 0x031B, 0x03A4, 0x02AF, 0x0372, 0x0266,
+            0x031C, 0x025D, 0x025C, 0x018E, 0x022F, 0x0135, 0x01D2, 0x00B7,
+            0x018F, 0x00B5, 0x00B4, 0x0080, 0x004C, 0x0026, 0x8000, 0x8000,
+        },
+        {
+            /* Name: Studio Medium, SPU mem required: 0x4840 */
+            0x00B1, 0x007F, 0x70F0, 0x4FA8, 0xBCE0, 0x4510, 0xBEF0, 0xB4C0,
+            0x5280, 0x4EC0, 0x0904, 0x076B, 0x0824, 0x065F, 0x07A2, 0x0616,
+            0x076C, 0x05ED, 0x05EC, 0x042E, 0x050F, 0x0305, 0x0462, 0x02B7,
+            0x042F, 0x0265, 0x0264, 0x01B2, 0x0100, 0x0080, 0x8000, 0x8000,
+        },
+        {
+            /* Name: Studio Large, SPU mem required: 0x6FE0*/
+            0x00E3, 0x00A9, 0x6F60, 0x4FA8, 0xBCE0, 0x4510, 0xBEF0, 0xA680,
+            0x5680, 0x52C0, 0x0DFB, 0x0B58, 0x0D09, 0x0A3C, 0x0BD9, 0x0973,
+            0x0B59, 0x08DA, 0x08D9, 0x05E9, 0x07EC, 0x04B0, 0x06EF, 0x03D2,
+            0x05EA, 0x031D, 0x031C, 0x0238, 0x0154, 0x00AA, 0x8000, 0x8000,
+        },
+        {
+            /* Name: Hall, SPU mem required: 0xADE0 */
+            0x01A5, 0x0139, 0x6000, 0x5000, 0x4C00, 0xB800, 0xBC00, 0xC000,
+            0x6000, 0x5C00, 0x15BA, 0x11BB, 0x14C2, 0x10BD, 0x11BC, 0x0DC1,
+            0x11C0, 0x0DC3, 0x0DC0, 0x09C1, 0x0BC4, 0x07C1, 0x0A00, 0x06CD,
+            0x09C2, 0x05C1, 0x05C0, 0x041A, 0x0274, 0x013A, 0x8000, 0x8000,
+        },
+        {
+            /* Name: Half Echo, SPU mem required: 0x3C00 */
+            0x0017, 0x0013, 0x70F0, 0x4FA8, 0xBCE0, 0x4510, 0xBEF0, 0x8500,
+            0x5F80, 0x54C0, 0x0371, 0x02AF, 0x02E5, 0x01DF, 0x02B0, 0x01D7,
+            0x0358, 0x026A, 0x01D6, 0x011E, 0x012D, 0x00B1, 0x011F, 0x0059,
+            0x01A0, 0x00E3, 0x0058, 0x0040, 0x0028, 0x0014, 0x8000, 0x8000,
+        },
+        {
+            /* Name: Space Echo, SPU mem required: 0xF6C0 */
+            0x033D, 0x0231, 0x7E00, 0x5000, 0xB400, 0xB000, 0x4C00, 0xB000,
+            0x6000, 0x5400, 0x1ED6, 0x1A31, 0x1D14, 0x183B, 0x1BC2, 0x16B2,
+            0x1A32, 0x15EF, 0x15EE, 0x1055, 0x1334, 0x0F2D, 0x11F6, 0x0C5D,
+            0x1056, 0x0AE1, 0x0AE0, 0x07A2, 0x0464, 0x0232, 0x8000, 0x8000,
+        },
+        {
+            /* Name: Chaos Echo, SPU mem required: 0x18040 */
+            0x0001, 0x0001, 0x7FFF, 0x7FFF, 0x0000, 0x0000, 0x0000, 0x8100,
+            0x0000, 0x0000, 0x1FFF, 0x0FFF, 0x1005, 0x0005, 0x0000, 0x0000,
+            0x1005, 0x0005, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+            0x0000, 0x0000, 0x1004, 0x1002, 0x0004, 0x0002, 0x8000, 0x8000,
+        },
+        {
+            /* Name: Delay, SPU mem required: 0x18040 */
+            0x0001, 0x0001, 0x7FFF, 0x7FFF, 0x0000, 0x0000, 0x0000, 0x0000,
+            0x0000, 0x0000, 0x1FFF, 0x0FFF, 0x1005, 0x0005, 0x0000, 0x0000,
+            0x1005, 0x0005, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+            0x0000, 0x0000, 0x1004, 0x1002, 0x0004, 0x0002, 0x8000, 0x8000,
+        },
+        {
+            /* Name: Off, SPU mem required: 0x10 */
+            0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+            0x0000, 0x0000, 0x0001, 0x0001, 0x0001, 0x0001, 0x0001, 0x0001,
+            0x0000, 0x0000, 0x0001, 0x0001, 0x0001, 0x0001, 0x0001, 0x0001,
+            0x0000, 0x0000, 0x0001, 0x0001, 0x0001, 0x0001, 0x0000, 0x0000,
+        },
+    };
+}
+
+const uint16_t (&PsxVerb::presets)[NUM_PRESETS][0x20] = spu_presets;
+
+// One preset's registers at one network rate, worked out exactly as
+// loadPreset() does at run time
+template <int Preset, int Rate>
+struct PsxVerb::Constants {
+    static constexpr const uint16_t* reg = spu_presets[Preset];
+    static constexpr float stretch_factor = (float) Rate / SPU_REV_RATE;
+
+    static constexpr uint32_t tap(int index) {
+        return (uint32_t)((reg[index] << 2) * stretch_factor);
+    }
+
+    static constexpr float coefficient(int index) {
+        return s2f((int16_t) reg[index]);
+    }
+
+    static constexpr uint32_t dAPF1 = tap(0), dAPF2 = tap(1);
+    // The rate correction divides by zero for a zero alpha, which maps to
+    // zero at run time anyway
+    static constexpr float vIIR = reg[2] == 0 ? 0.0f : fc2alpha(alpha2fc(coefficient(2), SPU_REV_RATE), (float) Rate);
+    static constexpr float vCOMB1 = coefficient(3), vCOMB2 = coefficient(4), vCOMB3 = coefficient(5), vCOMB4 = coefficient(6);
+    static constexpr float vWALL = coefficient(7), vAPF1 = coefficient(8), vAPF2 = coefficient(9);
+    static constexpr uint32_t mLSAME = tap(10), mRSAME = tap(11), mLCOMB1 = tap(12), mRCOMB1 = tap(13);
+    static constexpr uint32_t mLCOMB2 = tap(14), mRCOMB2 = tap(15), dLSAME = tap(16), dRSAME = tap(17);
+    static constexpr uint32_t mLDIFF = tap(18), mRDIFF = tap(19), mLCOMB3 = tap(20), mRCOMB3 = tap(21);
+    static constexpr uint32_t mLCOMB4 = tap(22), mRCOMB4 = tap(23), dLDIFF = tap(24), dRDIFF = tap(25);
+    static constexpr uint32_t mLAPF1 = tap(26), mRAPF1 = tap(27), mLAPF2 = tap(28), mRAPF2 = tap(29);
+
+    static constexpr bool hasComb2 = vCOMB2 != 0.0f, hasComb3 = vCOMB3 != 0.0f, hasComb4 = vCOMB4 != 0.0f;
+    static constexpr bool hasWall = vWALL != 0.0f, hasApf1 = vAPF1 != 0.0f, hasApf2 = vAPF2 != 0.0f;
+};
+
+void PsxVerb::selectKernels() {
+    // Network rates worth a kernel of their own: the common host rates, and
+    // the SPU's own for native mode. Anything else runs the generic kernels.
+    static constexpr int rates[] = { 22050, 44100, 48000, 96000 };
+    struct Kernels {
+        Kernel scalar, run;
+    };
+
+    static constexpr auto kernels = [] <size_t... R> (std::index_sequence<R...>) {
+        auto presetsAt = [] <int Rate, int... P> (std::integer_sequence<int, P...>) {
+            return std::array<Kernels, NUM_PRESETS> { { { &PsxVerb::processScalarAs<P, Rate>, &PsxVerb::processRunAs<P, Rate> }... } };
+        };
+        return std::array<std::array<Kernels, NUM_PRESETS>, sizeof... (R)> {
+            presetsAt.template operator()<rates[R]> (std::make_integer_sequence<int, NUM_PRESETS> {})...
+        };
+    } (std::make_index_sequence<std::size (rates)> {});
+
+    scalar_kernel = &PsxVerb::processScalar;
+    run_kernel = &PsxVerb::processRun;
+    if (active_engine == Engine::Half) {
+        scalar_kernel = &PsxVerb::processPackedScalar<HalfFormat>;
+        run_kernel = &PsxVerb::processPackedRun<HalfFormat>;
+    } else if (active_engine == Engine::BFloat) {
+        scalar_kernel = &PsxVerb::processPackedScalar<BFloatFormat>;
+        run_kernel = &PsxVerb::processPackedRun<BFloatFormat>;
+    }
+    if (active_engine != Engine::Float)
+        return;
+
+    for (size_t r = 0; r < std::size (rates); r++) {
+        if (network_rate == (float) rates[r]) {
+            scalar_kernel = kernels[r][(size_t) preset_index].scalar;
+            run_kernel = kernels[r][(size_t) preset_index].run;
+        }
+    }
+}
+
+// SPU memory each preset above needs, in bytes
+const uint32_t PsxVerb::preset_memory[NUM_PRESETS] = {
+    0x26C0, 0x1F40, 0x4840, 0x6FE0, 0xADE0, 0x3C00, 0xF6C0, 0x18040, 0x18040, 0x10,
+};
+
+// Seconds each preset takes to fall below SILENCE after a second of
+// full-scale noise, the longest measured from 44.1 to 96 kHz plus 10%,
+// rounded up. Chaos Echo feeds back at unity and never does.
+const float PsxVerb::tail_seconds[NUM_PRESETS] = {
+    2.0f, 2.4f, 2.5f, 5.8f, 4.8f, 5.0f, 9.9f, 0.0f, 0.9f, 0.0f,
+};
+
+const bool PsxVerb::rings_forever[NUM_PRESETS] = {
+    false, false, false, false, false, false, false, true, false, false,
+};
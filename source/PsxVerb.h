@@ -1,9 +1,12 @@
 #pragma once
 
+#include "PolyphaseResampler.h"
+#include "SpuMemory.h"
 #include <cstdint>
 #include <algorithm>
 #include <cstdint>
 #include <cmath>
+#include <vector>
 #include <algorithm>
 
 // Platform-independent definition of pi
@@ -16,21 +19,153 @@
 
 class PsxVerb {
 public:
+    enum class Engine
+    {
+        Float,
+        // int16 SPU RAM with the hardware's 16-bit saturating multiply-accumulate
+        Fixed,
+        // Float arithmetic over a ring of 16-bit floats, IEEE half or
+        // bfloat16: half the memory and bandwidth of Float, for a little
+        // rounding noise in the tail
+        Half,
+        BFloat,
+    };
+
+    // Where the network's delay lines live
+    enum class Layout
+    {
+        // One ring every tap indexes into, as in SPU RAM. Presets overlap
+        // their regions in it, which a preset change without clearing replays.
+        Shared,
+        // A ring of its own per written line (L/R SAME, DIFF, APF1 and APF2),
+        // each sized to the longest delay read from it and mirrored so runs
+        // never wrap. Same output from a clean ring; float engine only.
+        Lines,
+    };
+
+    // One channel of a multichannel bus, for setSpeakers()
+    struct Speaker
+    {
+        // -1 hard left, 0 centre, 1 hard right
+        float pan;
+        // LFE and the like only pass their dry signal
+        bool wet;
+    };
+    static constexpr int MAX_SPEAKERS = 16;
+
     PsxVerb();
     ~PsxVerb();
 
+    // Allocates on the first call only, or when a later one needs more
+    // memory than any before it. Not real-time safe in that case.
     void init(float sampleRate);
+    // Highest rate init() is expected to see, so the first call can reserve
+    // enough for every later one
+    void setMaxSampleRate(float maxSampleRate);
 
     void process(float* leftBuffer, float* rightBuffer, int numSamples);
+    // Swaps in a preset's taps without touching the ring, whose old contents
+    // would replay through the new taps. Clear it first, or switch through
+    // PsxVerbCrossfader, which does both without a gap.
     void setPreset(int presetIndex);
     void setWetGain(float newWet);
     void setDryGain(float newDry);
     void setMasterGain(float gain);
+    // Moves wet and dry to new gains in a straight line over the next
+    // rampSamples samples processed, or at once for 0. A later call starts
+    // its ramp from wherever this one has got to.
+    void setGains(float newWet, float newDry, int rampSamples);
+
+    // Run the network at the SPU's own 22050 Hz, with only the wet path
+    // resampled to and from the host rate. Takes effect on the next init().
+    void setNativeRate(bool shouldRunNative);
+    // Takes effect on the next init()
+    void setEngine(Engine newEngine);
+    // Takes effect on the next init(). Only the float engine has Lines, the
+    // others always use Shared.
+    void setLayout(Layout newLayout);
+
+    // Sets up processSpeakers() for a bus of up to MAX_SPEAKERS channels, or
+    // turns it off with a count of 0. Every wet channel is folded by its pan
+    // into the network's two inputs. The first wet speaker left of centre and
+    // the first right of it take the network's own outputs; every other wet
+    // speaker reads taps of its own further back in the same ring, so each
+    // extra speaker costs a few reads per sample and no memory. Takes effect
+    // on the next init(), and with speakers set that runs the Shared layout
+    // at the host rate whatever setLayout() and setNativeRate() asked for.
+    void setSpeakers(const Speaker* newSpeakers, int count);
+    int getNumSpeakers() const { return num_speakers; }
+    // process() for the bus given to setSpeakers(), one buffer per speaker
+    void processSpeakers(float* const* channels, int numSamples);
+
+    // Silences the network a slice at a time, so clearing never costs a whole
+    // ring's memset in one audio callback. startClearing() drops the resampler
+    // state right away; clearSome() then zeroes up to maxSamples ring cells
+    // per call and returns true once the ring is clean. Don't process() until then.
+    void startClearing();
+    bool clearSome(uint32_t maxSamples);
+
+    // What the ring holds, for visualizers: the RMS of each written line's
+    // history (L/R SAME, L/R DIFF, L/R APF1, L/R APF2) and how long it is
+    static constexpr int NUM_REGIONS = 8;
+    struct RingEnergy
+    {
+        float rms[NUM_REGIONS];
+        float seconds[NUM_REGIONS];
+    };
+    // Reads every SCAN_STRIDE-th cell of up to maxCells more of the ring,
+    // carrying on from the last call. Fills energy and returns true each time
+    // that completes a pass over every line.
+    bool scanRing(uint32_t maxCells, RingEnergy& energy);
+    // Peaks into and out of the network since the last call, after the input
+    // gain and before the wet gain
+    struct Levels
+    {
+        float dry, wet;
+    };
+    Levels takeLevels();
+
+    // How long the current preset rings on after loud input stops, for the
+    // host. Infinite for the presets that repeat forever.
+    double getTailSeconds() const;
+    // Whether the current preset repeats forever. Ask this rather than test
+    // getTailSeconds() for infinity, which -Ofast builds assume never occurs.
+    bool ringsForever() const;
+    // The network sleeps once input and output have both stayed silent for
+    // a whole ring, and costs next to nothing until it wakes on the first
+    // audible input sample
+    bool isSleeping() const { return sleeping; }
+    // Ring cells the current preset reads and writes per sample once its
+    // zero-coefficient taps are pruned, 0 when it can't make a sound. A rough
+    // measure of how much work the network does, for benchmarks.
+    int getRingAccessesPerSample() const { return plan.inert ? 0 : plan.accesses; }
 
 private:
+    // Runs many instances from the same preset tables
+    friend class PsxVerbBank;
+    // Cuts its rendered responses off at the preset's tail
+    friend class PsxVerbConvolver;
+
     static constexpr int NUM_PRESETS = 10;
     static constexpr float SPU_REV_RATE = 22050.0f;
-    
+
+    // Most samples process() takes through the network per step
+    static constexpr int CHUNK_MAX = 512;
+    // Longest run of samples the block kernel processes at once
+    static constexpr int BLOCK_MAX = 64;
+    // Runs shorter than this aren't worth the block setup, use the scalar loop
+    static constexpr int BLOCK_MIN = 4;
+    // Levels treated as silence, about -120 dBFS. The fixed engine truncates,
+    // which leaves a few LSBs circulating for good, so those count as well.
+    static constexpr float SILENCE = 1.0e-6f;
+    static constexpr float FIXED_SILENCE = 4.0f / 32768.0f;
+    // Rounding to half floats does the same in the subnormal steps of 2^-24,
+    // a few dozen of which can keep going round
+    static constexpr float HALF_SILENCE = 64.0f / 16777216.0f;
+    // Ring cells cleared per chunk while asleep
+    static constexpr uint32_t SLEEP_CLEAR_SLICE = 16384;
+    // Cells scanRing() steps over per read
+    static constexpr uint32_t SCAN_STRIDE = 16;
 
     typedef struct PsxVerbPreset {
         uint16_t dAPF1;
@@ -69,6 +204,65 @@ private:
 
     void loadPreset(int presetIndex);
 
+    // The network proper: input-gained samples in, wet samples out
+    void processNetwork(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    void processResampled(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    void processScalar(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    void processRun(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    void processFixedScalar(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    void processFixedRun(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    int runLength(int numSamples) const;
+    void trackSilence(const float* Lin, const float* Rin, const float* Lout, const float* Rout, int numSamples);
+    // One chunk of process() after the input gain: wakes the network if it
+    // sleeps, runs it and tracks silence. Returns the first sample it ran
+    // for, numSamples if it slept through; Lout and Rout are only written
+    // from there on.
+    int runChunk(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    // Per-sample wet and dry gains for the next numSamples samples while a
+    // setGains() ramp runs. False when none does and wet and dry hold.
+    bool nextGains(float* wetGains, float* dryGains, int numSamples);
+    void updatePlan();
+    void updateBlockLimit();
+    // Works out which line each read of the Lines layout takes its sample
+    // from and how long ago, and how long the lines must be. Places them in
+    // spu_buffer when there is one.
+    void updateLines();
+    void processLines(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    int linesRunLength(int numSamples) const;
+    // Picks each extra speaker's taps for the loaded preset
+    void updateSpeakerTaps();
+    // Adds an extra speaker's taps for the run the network just processed
+    // from address on into out
+    void readSpeakerTaps(int speaker, uint32_t address, float* out, int numSamples) const;
+
+    // Taps and coefficients as the float kernels read them: Registers holds
+    // the loaded preset's at run time, Constants<Preset, Rate> has the same
+    // fields fixed at compile time so its kernels fold the address arithmetic
+    // and leave out the terms whose coefficient is zero
+    struct Registers;
+    using Kernel = void (PsxVerb::*)(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    template <int Preset, int Rate> struct Constants;
+    // Ring is spu_buffer, or PackedCells over spu_half for the 16-bit engines
+    template <typename Ring, typename Taps>
+    void processScalarWith(Ring ring, const Taps& taps, const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    template <typename Ring, typename Taps>
+    void processRunWith(Ring ring, const Taps& taps, const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    template <int Preset, int Rate>
+    void processScalarAs(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    template <int Preset, int Rate>
+    void processRunAs(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    // The float kernels over spu_half, Format being HalfFormat or BFloatFormat
+    template <typename Format>
+    void processPackedScalar(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    template <typename Format>
+    void processPackedRun(const float* Lin, const float* Rin, float* Lout, float* Rout, int numSamples);
+    Registers registers() const;
+    // One ring cell as a float, whichever engine's ring it is
+    float readCell(uint32_t index) const;
+    // Points the float kernels at the active preset's specialization, if
+    // the network runs at one of the rates they're built for
+    void selectKernels();
+
     static float avg (float a, float b)
     {
         return (a + b) / 2.0f;
@@ -88,13 +282,24 @@ private:
         return (int16_t) (clampf (v * 32768.0f, -32768.0f, 32767.0f));
     }
 
-    static float s2f (int16_t v)
+    static constexpr float s2f (int16_t v)
     {
         return (float) (v) / 32768.0f;
     }
 
+    static int16_t sat16 (int32_t v)
+    {
+        return (int16_t) std::clamp (v, (int32_t) -32768, (int32_t) 32767);
+    }
+
+    // SPU multiply: 16 x 16 bits, truncated back to 16 fractional bits
+    static int32_t mul15 (int32_t a, int32_t b)
+    {
+        return (a * b) >> 15;
+    }
+
     /* convert iir filter constant to center frequency */
-    static float alpha2fc (float alpha, float samplerate)
+    static constexpr float alpha2fc (float alpha, float samplerate)
     {
         const double dt = 1.0 / samplerate;
         const double fc_inv = 2.0 * M_PI * (dt / alpha - dt);
@@ -102,7 +307,7 @@ private:
     }
 
     /* convert center frequency to iir filter constant */
-    static float fc2alpha (float fc, float samplerate)
+    static constexpr float fc2alpha (float fc, float samplerate)
     {
         const double dt = 1.0 / samplerate;
         const double rc = 1.0 / (2.0 * M_PI * fc);
@@ -121,13 +326,43 @@ private:
         return x;
     }
 
-    float rate;
+    float rate, max_rate;
+    // Rate the network runs at, either rate or SPU_REV_RATE in native mode
+    float network_rate;
+    bool native_rate, resampled;
+    PolyphaseResampler decimator, interpolator;
+    std::vector<float> wet_fifo_l, wet_fifo_r;
+    int wet_fifo_fill, wet_fifo_primed;
+
+    Engine engine, active_engine;
+
+    // The active engine's ring lives in spu_memory, the other pointers are null
+    SpuMemory spu_memory;
     float* spu_buffer;
+    int16_t* spu_ram;
+    // Half and BFloat share it, in their own formats
+    uint16_t* spu_half;
+    // Cells allocated for the longest preset; the active preset only uses a
+    // window of spu_buffer_count cells at the start
+    uint32_t spu_buffer_capacity;
     uint32_t spu_buffer_count;
     uint32_t spu_buffer_count_mask;
+    // Widest window used since the ring was last clean, cells past it are zero
+    uint32_t spu_buffer_used;
     uint32_t BufferAddress;
+    // Progress of an incremental clear, which is done when position reaches end
+    uint32_t clear_position, clear_end;
+
+    bool sleeping;
+    // Samples input and output have been silent for, and how many put the
+    // network to sleep
+    int quiet_samples, quiet_limit;
 
     float dry, wet, master;
+    // setGains()' ramp, samples left and where it ends
+    int ramp_remaining;
+    float wet_step, dry_step;
+    float wet_target, dry_target;
     PsxVerbPreset preset;
     int preset_index;
 
@@ -139,6 +374,96 @@ private:
     uint32_t dLDIFF, dRDIFF, mLAPF1, mRAPF1, mLAPF2, mRAPF2;
     float vLIN, vRIN;
 
-    static const uint16_t presets[NUM_PRESETS][0x20];
+    // Which parts of the network the active preset uses. A term whose
+    // coefficient is zero adds exactly nothing, so the kernels skip its taps
+    // and updateBlockLimit() leaves them out of the block analysis.
+    struct Plan {
+        bool comb2, comb3, comb4;
+        bool wall;
+        // An APF with a zero coefficient only delays
+        bool apf1, apf2;
+        // No comb feeds the output and both APFs pass silence straight
+        // through, so the wet path is silent whatever the ring holds and
+        // process() is just the dry path's gain
+        bool inert;
+        int accesses;
+    } plan;
+
+    Layout layout, active_layout;
+
+    // The Lines layout. Lines are in the order the network writes them:
+    // L/R SAME, L/R DIFF, then L/R APF1 and L/R APF2.
+    static constexpr int NUM_LINES = NUM_REGIONS;
+    // Wall and previous-sample reads of the four reflections, the combs
+    // left then right, then each APF's reads before and after its write
+    static constexpr int NUM_LINE_READS = 24;
+    struct Line {
+        // length cells, then the same again so reads run past the end
+        float* data;
+        uint32_t length;
+    };
+    struct LineRead {
+        int line;
+        uint32_t delay;
+    };
+    Line lines[NUM_LINES];
+    LineRead line_reads[NUM_LINE_READS];
+    // Cells the current preset's lines take up, mirrors included
+    uint32_t lines_cells;
+    // Shortest and longest line, BufferAddress counts modulo the longest
+    uint32_t lines_shortest, lines_period;
+    // Longest run processLines() can take, like block_limit, and whether
+    // its reflections run as paired lanes
+    int lines_block_limit;
+    bool lines_paired;
+
+    // Register values as the fixed-point engine uses them
+    struct {
+        int16_t vIIR, vCOMB1, vCOMB2, vCOMB3, vCOMB4, vWALL, vAPF1, vAPF2;
+    } fixed;
+
+    // Longest run the block kernel can take without changing the result of
+    // the per-sample loop, 0 when the active taps don't allow blocking
+    int block_limit;
+    // Every ring offset the block kernel touches, so runs can stop at the ring end
+    uint32_t block_taps[32];
+    int num_block_taps;
+    // How processRun orders its passes for the active taps
+    bool block_combs_first;
+    bool block_paired;
+
+    // The float engine's kernels for the active preset
+    Kernel scalar_kernel, run_kernel;
+
+    // scanRing()'s place in its pass and what it has summed so far
+    int scan_region;
+    uint32_t scan_cell;
+    float scan_sums[NUM_REGIONS];
+    uint32_t scan_counts[NUM_REGIONS];
+    Levels levels;
+
+    // Multichannel. processSpeakers() runs the network in runs of at most
+    // BLOCK_MAX and reads the extra speakers' taps after each run, so a tap
+    // is only usable if nothing the run writes lands on it: no line may
+    // start within BLOCK_MAX cells below it.
+    static constexpr int MAX_SPEAKER_TAPS = 8;
+    struct SpeakerState {
+        // Share of the channel in each network input
+        float foldL, foldR;
+        // Which network output it takes: 0 left, 1 right, -1 taps of its own
+        int main;
+        // Its own taps, the combs' on each side it leans to, read further back
+        int num_taps;
+        uint32_t taps[MAX_SPEAKER_TAPS];
+        float gains[MAX_SPEAKER_TAPS];
+    };
+    Speaker speakers[MAX_SPEAKERS];
+    SpeakerState speaker_state[MAX_SPEAKERS];
+    int num_speakers;
+
+    static const uint16_t (&presets)[NUM_PRESETS][0x20];
+    static const uint32_t preset_memory[NUM_PRESETS];
+    static const float tail_seconds[NUM_PRESETS];
+    static const bool rings_forever[NUM_PRESETS];
 };
 
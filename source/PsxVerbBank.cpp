@@ -0,0 +1,269 @@
+#include "PsxVerbBank.h"
+#include "PsxVerbSimd.h"
+#include <cstring>
+#include <new>
+
+PsxVerbBank::PsxVerbBank(int numInstances)
+    : instances ((size_t) numInstances)
+{
+    num_packs = (numInstances + LANES - 1) / LANES + PsxVerb::NUM_PRESETS;
+    packs = std::make_unique<Pack[]> ((size_t) num_packs);
+}
+
+void PsxVerbBank::init(float sampleRate) {
+    rate = sampleRate;
+    for (int p = 0; p < PsxVerb::NUM_PRESETS; p++)
+        loadNetwork(p);
+
+    for (int k = 0; k < num_packs; k++) {
+        packs[(size_t) k].preset = -1;
+        std::fill (packs[(size_t) k].instance, packs[(size_t) k].instance + LANES, -1);
+    }
+
+    // Instances are placed in order, which fills packs preset by preset
+    for (auto& instance : instances)
+        instance.pack = -1;
+    for (int i = 0; i < getNumInstances(); i++)
+        place(i);
+}
+
+void PsxVerbBank::loadNetwork(int presetIndex) {
+    // Same derivation as PsxVerb::loadPreset, once per preset for the bank
+    const float stretch_factor = rate / PsxVerb::SPU_REV_RATE;
+    const auto* preset = (const PsxVerb::PsxVerbPreset*) &PsxVerb::presets[presetIndex];
+    auto tap = [stretch_factor] (uint16_t reg) {
+        return (uint32_t) ((reg << 2) * stretch_factor);
+    };
+
+    Network& n = networks[presetIndex];
+    n.dAPF1   = tap(preset->dAPF1);
+    n.dAPF2   = tap(preset->dAPF2);
+    n.vIIR    = PsxVerb::fc2alpha(PsxVerb::alpha2fc(PsxVerb::s2f(preset->vIIR), PsxVerb::SPU_REV_RATE), rate);
+    n.vCOMB1  = PsxVerb::s2f(preset->vCOMB1);
+    n.vCOMB2  = PsxVerb::s2f(preset->vCOMB2);
+    n.vCOMB3  = PsxVerb::s2f(preset->vCOMB3);
+    n.vCOMB4  = PsxVerb::s2f(preset->vCOMB4);
+    n.vWALL   = PsxVerb::s2f(preset->vWALL);
+    n.vAPF1   = PsxVerb::s2f(preset->vAPF1);
+    n.vAPF2   = PsxVerb::s2f(preset->vAPF2);
+    n.mLSAME  = tap(preset->mLSAME);
+    n.mRSAME  = tap(preset->mRSAME);
+    n.mLCOMB1 = tap(preset->mLCOMB1);
+    n.mRCOMB1 = tap(preset->mRCOMB1);
+    n.mLCOMB2 = tap(preset->mLCOMB2);
+    n.mRCOMB2 = tap(preset->mRCOMB2);
+    n.dLSAME  = tap(preset->dLSAME);
+    n.dRSAME  = tap(preset->dRSAME);
+    n.mLDIFF  = tap(preset->mLDIFF);
+    n.mRDIFF  = tap(preset->mRDIFF);
+    n.mLCOMB3 = tap(preset->mLCOMB3);
+    n.mRCOMB3 = tap(preset->mRCOMB3);
+    n.mLCOMB4 = tap(preset->mLCOMB4);
+    n.mRCOMB4 = tap(preset->mRCOMB4);
+    n.dLDIFF  = tap(preset->dLDIFF);
+    n.dRDIFF  = tap(preset->dRDIFF);
+    n.mLAPF1  = tap(preset->mLAPF1);
+    n.mRAPF1  = tap(preset->mRAPF1);
+    n.mLAPF2  = tap(preset->mLAPF2);
+    n.mRAPF2  = tap(preset->mRAPF2);
+    n.vLIN    = PsxVerb::s2f(preset->vLIN);
+    n.vRIN    = PsxVerb::s2f(preset->vRIN);
+
+    const uint32_t furthest = std::max ({ n.dAPF1, n.dAPF2, n.mLSAME, n.mRSAME, n.mLCOMB1, n.mRCOMB1, n.mLCOMB2, n.mRCOMB2,
+        n.dLSAME, n.dRSAME, n.mLDIFF, n.mRDIFF, n.mLCOMB3, n.mRCOMB3, n.mLCOMB4, n.mRCOMB4,
+        n.dLDIFF, n.dRDIFF, n.mLAPF1, n.mRAPF1, n.mLAPF2, n.mRAPF2 });
+    const uint32_t required = (uint32_t) ceil (PsxVerb::preset_memory[presetIndex] / 2 * stretch_factor);
+    n.count = PsxVerb::ceilpower2 (std::max (required, furthest + 1));
+}
+
+void PsxVerbBank::place(int instance) {
+    Instance& inst = instances[(size_t) instance];
+    const Network& network = networks[inst.preset];
+
+    // A free lane in a pack already on this preset, or else an empty pack
+    int target = -1, lane = -1;
+    for (int k = 0; k < num_packs && target < 0; k++) {
+        if (packs[(size_t) k].preset != inst.preset)
+            continue;
+        for (int l = 0; l < LANES; l++) {
+            if (packs[(size_t) k].instance[l] < 0) {
+                target = k;
+                lane = l;
+                break;
+            }
+        }
+    }
+
+    if (target < 0) {
+        for (int k = 0; k < num_packs; k++) {
+            if (packs[(size_t) k].preset < 0) {
+                target = k;
+                lane = 0;
+                break;
+            }
+        }
+
+        Pack& pack = packs[(size_t) target];
+        const size_t bytes = network.count * LANES * sizeof (float);
+        pack.ring = static_cast<float*> (pack.memory.reserve (bytes));
+        if (pack.ring == nullptr)
+            throw std::bad_alloc();
+        memset (pack.ring, 0, bytes);
+        pack.address = 0;
+        pack.preset = inst.preset;
+    } else {
+        // Only this lane's cells are stale, the others carry live tails
+        float* ring = packs[(size_t) target].ring;
+        for (uint32_t c = 0; c < network.count; c++)
+            ring[c * LANES + (uint32_t) lane] = 0.0f;
+    }
+
+    packs[(size_t) target].instance[lane] = instance;
+    inst.pack = target;
+    inst.lane = lane;
+    updateLane(instance);
+}
+
+void PsxVerbBank::updateLane(int instance) {
+    const Instance& inst = instances[(size_t) instance];
+    if (inst.pack < 0)
+        return;
+
+    Pack& pack = packs[(size_t) inst.pack];
+    pack.wet[inst.lane] = inst.wet;
+    pack.dry[inst.lane] = inst.dry;
+    pack.master[inst.lane] = inst.master;
+}
+
+void PsxVerbBank::setPreset(int instance, int presetIndex) {
+    Instance& inst = instances[(size_t) instance];
+    if (presetIndex >= PsxVerb::NUM_PRESETS || presetIndex == inst.preset)
+        return;
+
+    inst.preset = presetIndex;
+    if (inst.pack < 0)
+        return;
+
+    Pack& old = packs[(size_t) inst.pack];
+    old.instance[inst.lane] = -1;
+    if (std::all_of (old.instance, old.instance + LANES, [] (int i) { return i < 0; }))
+        old.preset = -1;
+
+    place(instance);
+}
+
+void PsxVerbBank::setWetGain(int instance, float newWet) {
+    instances[(size_t) instance].wet = newWet;
+    updateLane(instance);
+}
+
+void PsxVerbBank::setDryGain(int instance, float newDry) {
+    instances[(size_t) instance].dry = newDry;
+    updateLane(instance);
+}
+
+void PsxVerbBank::setMasterGain(int instance, float gain) {
+    instances[(size_t) instance].master = gain;
+    updateLane(instance);
+}
+
+void PsxVerbBank::process(float* const* leftBuffers, float* const* rightBuffers, int numSamples) {
+    for (int k = 0; k < num_packs; k++) {
+        if (packs[(size_t) k].preset >= 0)
+            processPack(packs[(size_t) k], leftBuffers, rightBuffers, numSamples);
+    }
+}
+
+void PsxVerbBank::processPack(Pack& pack, float* const* leftBuffers, float* const* rightBuffers, int numSamples) {
+    const Network& n = networks[pack.preset];
+    const uint32_t mask = n.count - 1;
+    float* const ring = pack.ring;
+
+    const Lanes4 wall = Lanes4::broadcast(n.vWALL), iir = Lanes4::broadcast(n.vIIR);
+    const Lanes4 comb1 = Lanes4::broadcast(n.vCOMB1), comb2 = Lanes4::broadcast(n.vCOMB2);
+    const Lanes4 comb3 = Lanes4::broadcast(n.vCOMB3), comb4 = Lanes4::broadcast(n.vCOMB4);
+    const Lanes4 apf1 = Lanes4::broadcast(n.vAPF1), apf2 = Lanes4::broadcast(n.vAPF2);
+    const Lanes4 wet = Lanes4::load(pack.wet), dry = Lanes4::load(pack.dry), master = Lanes4::load(pack.master);
+
+    alignas (16) float Lin[CHUNK_MAX * LANES], Rin[CHUNK_MAX * LANES];
+    alignas (16) float Lmix[CHUNK_MAX * LANES], Rmix[CHUNK_MAX * LANES];
+
+    for (int done = 0; done < numSamples; done += CHUNK_MAX) {
+        const int count = std::min (CHUNK_MAX, numSamples - done);
+
+        // Interleave the lanes' input, silence for empty lanes
+        for (int l = 0; l < LANES; l++) {
+            const int i = pack.instance[l];
+            const float* left = i >= 0 && leftBuffers[i] != nullptr ? leftBuffers[i] + done : nullptr;
+            const float* right = i >= 0 && rightBuffers[i] != nullptr ? rightBuffers[i] + done : nullptr;
+            for (int s = 0; s < count; s++) {
+                Lin[s * LANES + l] = left != nullptr ? n.vLIN * left[s] : 0.0f;
+                Rin[s * LANES + l] = right != nullptr ? n.vRIN * right[s] : 0.0f;
+            }
+        }
+
+        // PsxVerb::processScalar, one vector of instances per statement
+        uint32_t address = pack.address;
+        for (int s = 0; s < count; s++) {
+            auto cell = [&] (uint32_t offset) {
+                return ring + ((offset + address) & mask) * LANES;
+            };
+            auto reflect = [&] (Lanes4 in, uint32_t wallTap, uint32_t line) {
+                const Lanes4 prev = Lanes4::load(cell(line - 1));
+                ((in + Lanes4::load(cell(wallTap)) * wall - prev) * iir + prev).store(cell(line));
+            };
+            auto apf = [&] (Lanes4 out, uint32_t m, uint32_t d, Lanes4 v) {
+                out = out - v * Lanes4::load(cell(m - d));
+                out.store(cell(m));
+                return out * v + Lanes4::load(cell(m - d));
+            };
+
+            const Lanes4 L = Lanes4::load(Lin + s * LANES);
+            const Lanes4 R = Lanes4::load(Rin + s * LANES);
+
+            // Same side reflection
+            reflect(L, n.dLSAME, n.mLSAME);
+            reflect(R, n.dRSAME, n.mRSAME);
+
+            // Different side reflection
+            reflect(L, n.dRDIFF, n.mLDIFF);
+            reflect(R, n.dLDIFF, n.mRDIFF);
+
+            // Early echo
+            Lanes4 Lout = comb1 * Lanes4::load(cell(n.mLCOMB1)) + comb2 * Lanes4::load(cell(n.mLCOMB2)) +
+                comb3 * Lanes4::load(cell(n.mLCOMB3)) + comb4 * Lanes4::load(cell(n.mLCOMB4));
+            Lanes4 Rout = comb1 * Lanes4::load(cell(n.mRCOMB1)) + comb2 * Lanes4::load(cell(n.mRCOMB2)) +
+                comb3 * Lanes4::load(cell(n.mRCOMB3)) + comb4 * Lanes4::load(cell(n.mRCOMB4));
+
+            // Late reverb APFs
+            Lout = apf(Lout, n.mLAPF1, n.dAPF1, apf1);
+            Rout = apf(Rout, n.mRAPF1, n.dAPF1, apf1);
+            Lout = apf(Lout, n.mLAPF2, n.dAPF2, apf2);
+            Rout = apf(Rout, n.mRAPF2, n.dAPF2, apf2);
+
+            address = (address + 1) & mask;
+
+            ((Lout * wet + L * dry) * master).store(Lmix + s * LANES);
+            ((Rout * wet + R * dry) * master).store(Rmix + s * LANES);
+        }
+        pack.address = address;
+
+        for (int l = 0; l < LANES; l++) {
+            const int i = pack.instance[l];
+            if (i < 0)
+                continue;
+
+            // Left then right, so a shared mono buffer ends up with the right side like PsxVerb
+            if (leftBuffers[i] != nullptr) {
+                float* left = leftBuffers[i] + done;
+                for (int s = 0; s < count; s++)
+                    left[s] = Lmix[s * LANES + l];
+            }
+            if (rightBuffers[i] != nullptr) {
+                float* right = rightBuffers[i] + done;
+                for (int s = 0; s < count; s++)
+                    right[s] = Rmix[s * LANES + l];
+            }
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "PsxVerb.h"
+#include <memory>
+
+// Many PsxVerb instances at one sample rate, processed together. Instances on
+// the same preset share packs of four, whose rings interleave the four lanes
+// cell by cell, so every tap is one vector load and the whole network runs
+// across instances in SIMD. Gains are kept per lane, interleaved the same way.
+//
+// setPreset() moves an instance to a pack of its new preset and clears its
+// lane. That may allocate when a pack first takes a longer preset, so call it
+// between process() calls rather than from another thread.
+class PsxVerbBank {
+public:
+    explicit PsxVerbBank(int numInstances);
+
+    void init(float sampleRate);
+
+    // One left and right buffer per instance, processed in place. Buffers may
+    // be null for instances that have no input this block.
+    void process(float* const* leftBuffers, float* const* rightBuffers, int numSamples);
+
+    void setPreset(int instance, int presetIndex);
+    void setWetGain(int instance, float newWet);
+    void setDryGain(int instance, float newDry);
+    void setMasterGain(int instance, float gain);
+
+    int getNumInstances() const { return (int) instances.size(); }
+
+private:
+    static constexpr int LANES = 4;
+    static constexpr int CHUNK_MAX = 256;
+
+    // A preset's taps and coefficients at the bank's rate
+    struct Network {
+        uint32_t dAPF1, dAPF2;
+        float vIIR, vCOMB1, vCOMB2, vCOMB3, vCOMB4, vWALL, vAPF1, vAPF2;
+        uint32_t mLSAME, mRSAME, mLCOMB1, mRCOMB1, mLCOMB2, mRCOMB2;
+        uint32_t dLSAME, dRSAME, mLDIFF, mRDIFF, mLCOMB3, mRCOMB3, mLCOMB4, mRCOMB4;
+        uint32_t dLDIFF, dRDIFF, mLAPF1, mRAPF1, mLAPF2, mRAPF2;
+        float vLIN, vRIN;
+        // Ring window, in cells
+        uint32_t count;
+    };
+
+    struct Pack {
+        // -1 while the pack holds no instances
+        int preset = -1;
+        int instance[LANES] = { -1, -1, -1, -1 };
+        alignas (16) float wet[LANES] = {};
+        alignas (16) float dry[LANES] = {};
+        alignas (16) float master[LANES] = {};
+
+        // LANES floats per cell
+        SpuMemory memory;
+        float* ring = nullptr;
+        uint32_t address = 0;
+    };
+
+    struct Instance {
+        int preset = 0;
+        float wet = 1.0f, dry = 1.0f, master = 1.0f;
+        int pack = -1, lane = 0;
+    };
+
+    void loadNetwork(int presetIndex);
+    void place(int instance);
+    void updateLane(int instance);
+    void processPack(Pack& pack, float* const* leftBuffers, float* const* rightBuffers, int numSamples);
+
+    float rate = 0.0f;
+    Network networks[PsxVerb::NUM_PRESETS];
+
+    std::vector<Instance> instances;
+    // Enough packs for every instance even when each preset leaves one part-full
+    std::unique_ptr<Pack[]> packs;
+    int num_packs = 0;
+};
@@ -0,0 +1,423 @@
+#include "PsxVerbConvolver.h"
+#include "PsxVerb.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace
+{
+    // Responses are indexed by output * 2 + input
+    enum Path { LL, RL, LR, RR, NUM_PATHS };
+
+    // out += h * x over a stretch of complex bins
+    void multiplyAdd(float* __restrict outRe, float* __restrict outIm, const float* __restrict hRe, const float* __restrict hIm,
+        const float* __restrict xRe, const float* __restrict xIm, int begin, int end)
+    {
+        for (int bin = begin; bin < end; bin++) {
+            outRe[bin] += hRe[bin] * xRe[bin] - hIm[bin] * xIm[bin];
+            outIm[bin] += hRe[bin] * xIm[bin] + hIm[bin] * xRe[bin];
+        }
+    }
+}
+
+struct PsxVerbConvolver::KernelSegment {
+    int size, offset, parts, bins;
+    SplitFft fft;
+    // Spectra of each partition of each path, [part][path][bin], scaled to
+    // suit the unscaled transforms
+    std::vector<float> re, im;
+};
+
+struct PsxVerbConvolver::Kernel {
+    int length = 0;
+    // The reference's dry output for a unit input
+    float dry_left = 0.0f, dry_right = 0.0f;
+    // The first HEAD_SIZE taps of each path, reversed
+    float head[NUM_PATHS][HEAD_SIZE] = {};
+    std::vector<KernelSegment> segments;
+};
+
+PsxVerbConvolver::PsxVerbConvolver() {
+    std::fill (head_left, head_left + 2 * HEAD_SIZE, 0.0f);
+    std::fill (head_right, head_right + 2 * HEAD_SIZE, 0.0f);
+}
+
+PsxVerbConvolver::~PsxVerbConvolver() = default;
+
+void PsxVerbConvolver::init(float sampleRate) {
+    rate = sampleRate;
+    loadKernel();
+}
+
+void PsxVerbConvolver::setPreset(int presetIndex) {
+    if (presetIndex < 0 || presetIndex >= PsxVerb::NUM_PRESETS)
+        return;
+    preset_index = presetIndex;
+    loadKernel();
+}
+
+void PsxVerbConvolver::setWetGain(float newWet) {
+    wet = newWet;
+}
+
+void PsxVerbConvolver::setDryGain(float newDry) {
+    dry = newDry;
+}
+
+void PsxVerbConvolver::setMasterGain(float gain) {
+    master = gain;
+}
+
+void PsxVerbConvolver::setMaxTailSeconds(float seconds) {
+    max_tail_seconds = std::max (0.0f, seconds);
+}
+
+void PsxVerbConvolver::setNumWorkers(int numWorkers) {
+    scheduler = numWorkers > 0 ? std::make_unique<ReverbScheduler>(numWorkers, MAX_TASKS) : nullptr;
+}
+
+int PsxVerbConvolver::getResponseLength() const {
+    return kernel != nullptr ? kernel->length : 0;
+}
+
+std::shared_ptr<const PsxVerbConvolver::Kernel> PsxVerbConvolver::getKernel(int presetIndex, float sampleRate, int length) {
+    // Kept for the life of the process: a few MB per preset and rate, and
+    // every convolver on the same one shares it
+    static std::mutex mutex;
+    static std::map<std::tuple<int, float, int>, std::shared_ptr<const Kernel>> cache;
+
+    std::lock_guard<std::mutex> lock (mutex);
+    auto& cached = cache[{ presetIndex, sampleRate, length }];
+    if (cached == nullptr)
+        cached = renderKernel(presetIndex, sampleRate, length);
+    return cached;
+}
+
+std::shared_ptr<const PsxVerbConvolver::Kernel> PsxVerbConvolver::renderKernel(int presetIndex, float sampleRate, int length) {
+    auto kernel = std::make_shared<Kernel>();
+    kernel->length = length;
+
+    // An impulse into each input in turn, wet path only
+    std::vector<float> responses[NUM_PATHS];
+    for (int input = 0; input < 2; input++) {
+        std::vector<float> left ((size_t) length), right ((size_t) length);
+        PsxVerb reference;
+        reference.init(sampleRate);
+        reference.setPreset(presetIndex);
+        reference.setWetGain(1.0f);
+        reference.setDryGain(0.0f);
+        if (length > 0) {
+            (input == 0 ? left : right)[0] = 1.0f;
+            reference.process(left.data(), right.data(), length);
+        }
+        responses[input] = std::move (left);
+        responses[2 + input] = std::move (right);
+    }
+
+    // And one sample of the dry path
+    {
+        PsxVerb reference;
+        reference.init(sampleRate);
+        reference.setPreset(presetIndex);
+        reference.setWetGain(0.0f);
+        reference.setDryGain(1.0f);
+        float left = 1.0f, right = 1.0f;
+        reference.process(&left, &right, 1);
+        kernel->dry_left = left;
+        kernel->dry_right = right;
+    }
+
+    for (int path = 0; path < NUM_PATHS; path++)
+        for (int j = 0; j < std::min (HEAD_SIZE, length); j++)
+            kernel->head[path][HEAD_SIZE - 1 - j] = responses[path][(size_t) j];
+
+    // Each segment but the last takes two partitions, then the next doubles
+    // them, which keeps every segment's offset at least its partition size
+    int size = HEAD_SIZE;
+    for (int offset = HEAD_SIZE; offset < length; size = std::min (2 * size, MAX_PARTITION)) {
+        int parts = (length - offset + size - 1) / size;
+        if (size < MAX_PARTITION)
+            parts = std::min (parts, 2);
+
+        const int bins = size + 1;
+        auto& segment = kernel->segments.emplace_back(KernelSegment { size, offset, parts, bins, SplitFft (2 * size), {}, {} });
+        segment.re.resize((size_t) (parts * NUM_PATHS * bins));
+        segment.im.resize((size_t) (parts * NUM_PATHS * bins));
+
+        // Zero-padded to twice the partition for overlap-save. The 1 / 4size
+        // undoes the inverse transform's gain and the factor of 2 that
+        // splitting the packed input spectra leaves in.
+        std::vector<float> re ((size_t) (2 * size)), im ((size_t) (2 * size));
+        const float scale = 1.0f / (float) (4 * size);
+        for (int part = 0; part < parts; part++) {
+            for (int path = 0; path < NUM_PATHS; path++) {
+                const int start = offset + part * size;
+                for (int n = 0; n < 2 * size; n++) {
+                    re[(size_t) n] = n < size && start + n < length ? responses[path][(size_t) (start + n)] : 0.0f;
+                    im[(size_t) n] = 0.0f;
+                }
+                segment.fft.forward(re.data(), im.data());
+
+                const size_t at = (size_t) ((part * NUM_PATHS + path) * bins);
+                for (int k = 0; k < bins; k++) {
+                    segment.re[at + (size_t) k] = re[(size_t) k] * scale;
+                    segment.im[at + (size_t) k] = im[(size_t) k] * scale;
+                }
+            }
+        }
+
+        offset += parts * size;
+    }
+
+    return kernel;
+}
+
+void PsxVerbConvolver::loadKernel() {
+    if (rate <= 0.0f)
+        return;
+
+    // Chaos Echo never ends, so the maximum cuts it short
+    const double seconds = PsxVerb::rings_forever[preset_index]
+        ? (double) max_tail_seconds
+        : std::min ((double) max_tail_seconds, (double) PsxVerb::tail_seconds[preset_index]);
+    kernel = getKernel(preset_index, rate, (int) std::ceil (seconds * rate));
+
+    segments.resize(kernel->segments.size());
+    uint32_t furthest = 0;
+    for (size_t s = 0; s < segments.size(); s++) {
+        const KernelSegment& k = kernel->segments[s];
+        Segment& segment = segments[s];
+        const auto slots = (size_t) (k.parts * k.bins);
+        const auto bins = (size_t) k.bins;
+
+        segment.kernel = &k;
+        segment.size = k.size;
+        segment.bins = k.bins;
+        segment.slot = 0;
+        for (auto* spectra : { &segment.left_re, &segment.left_im, &segment.right_re, &segment.right_im })
+            spectra->assign(slots, 0.0f);
+        for (auto* spectrum : { &segment.out_left_re, &segment.out_left_im, &segment.out_right_re, &segment.out_right_im })
+            spectrum->assign(bins, 0.0f);
+        segment.fft_re.assign((size_t) (2 * k.size), 0.0f);
+        segment.fft_im.assign((size_t) (2 * k.size), 0.0f);
+        segment.out_left.assign((size_t) k.size, 0.0f);
+        segment.out_right.assign((size_t) k.size, 0.0f);
+
+        furthest = std::max (furthest, (uint32_t) (k.offset + k.size));
+    }
+
+    // Each segment reads a window ending its offset back and reaching twice
+    // its size before that
+    uint32_t historySize = 1;
+    while (historySize < furthest + HEAD_SIZE)
+        historySize <<= 1;
+    history_left.assign(historySize, 0.0f);
+    history_right.assign(historySize, 0.0f);
+    history_mask = historySize - 1;
+
+    std::fill (head_left, head_left + 2 * HEAD_SIZE, 0.0f);
+    std::fill (head_right, head_right + 2 * HEAD_SIZE, 0.0f);
+    position = 0;
+    tasks.reserve(MAX_TASKS);
+}
+
+void PsxVerbConvolver::process(float* leftBuffer, float* rightBuffer, int numSamples) {
+    if (kernel == nullptr)
+        return;
+
+    const Kernel& k = *kernel;
+    const float dryLeft = k.dry_left * dry, dryRight = k.dry_right * dry;
+    const float wetGain = wet, masterGain = master;
+
+    for (int done = 0; done < numSamples;) {
+        const int offset = (int) (position % HEAD_SIZE);
+        if (offset == 0)
+            startBlock();
+
+        const int n = std::min (numSamples - done, HEAD_SIZE - offset);
+        float* left = leftBuffer + done;
+        float* right = rightBuffer + done;
+
+        // Both inputs are copied out before either output is written, in
+        // case they're the same buffer
+        float* inLeft = head_left + HEAD_SIZE + offset;
+        float* inRight = head_right + HEAD_SIZE + offset;
+        for (int i = 0; i < n; i++) {
+            inLeft[i] = left[i];
+            inRight[i] = right[i];
+            history_left[(position + (uint64_t) i) & history_mask] = left[i];
+            history_right[(position + (uint64_t) i) & history_mask] = right[i];
+        }
+
+        // Direct taps a tap at a time across the run, so the inner loop is
+        // a plain vector multiply-add
+        float wetLeft[HEAD_SIZE] = {}, wetRight[HEAD_SIZE] = {};
+        for (int j = 0; j < HEAD_SIZE; j++) {
+            const float ll = k.head[LL][j], rl = k.head[RL][j], lr = k.head[LR][j], rr = k.head[RR][j];
+            const float* xl = head_left + offset + 1 + j;
+            const float* xr = head_right + offset + 1 + j;
+            for (int i = 0; i < n; i++) {
+                wetLeft[i] += ll * xl[i] + rl * xr[i];
+                wetRight[i] += lr * xl[i] + rr * xr[i];
+            }
+        }
+
+        for (const Segment& segment : segments) {
+            const auto start = (size_t) (position & (uint64_t) (segment.size - 1));
+            const float* outLeft = segment.out_left.data() + start;
+            const float* outRight = segment.out_right.data() + start;
+            for (int i = 0; i < n; i++) {
+                wetLeft[i] += outLeft[i];
+                wetRight[i] += outRight[i];
+            }
+        }
+
+        for (int i = 0; i < n; i++) {
+            left[i] = (wetLeft[i] * wetGain + inLeft[i] * dryLeft) * masterGain;
+            right[i] = (wetRight[i] * wetGain + inRight[i] * dryRight) * masterGain;
+        }
+
+        position += (uint64_t) n;
+        done += n;
+    }
+}
+
+void PsxVerbConvolver::startBlock() {
+    // The block just finished becomes the previous one for the direct taps
+    std::copy (head_left + HEAD_SIZE, head_left + 2 * HEAD_SIZE, head_left);
+    std::copy (head_right + HEAD_SIZE, head_right + 2 * HEAD_SIZE, head_right);
+
+    // Segments whose next block starts here
+    int due[MAX_SEGMENTS];
+    int numDue = 0, largest = 0;
+    for (int s = 0; s < (int) segments.size(); s++) {
+        if ((position & (uint64_t) (segments[(size_t) s].size - 1)) == 0) {
+            due[numDue++] = s;
+            largest = std::max (largest, segments[(size_t) s].size);
+        }
+    }
+
+    if (scheduler == nullptr || largest < PARALLEL_SIZE) {
+        for (int d = 0; d < numDue; d++) {
+            Segment& segment = segments[(size_t) due[d]];
+            transformInput(segment);
+            multiply(segment, 0, segment.bins);
+            transformOutput(segment);
+        }
+        return;
+    }
+
+    // Three rounds: a transform per segment, the multiply-accumulates cut
+    // into stretches of bins, and an inverse transform per segment
+    auto input = [this, &due] (int d) { transformInput(segments[(size_t) due[d]]); };
+    scheduler->run(numDue, input);
+
+    tasks.clear();
+    for (int d = 0; d < numDue; d++)
+        for (int begin = 0; begin < segments[(size_t) due[d]].bins; begin += TASK_BINS)
+            tasks.push_back({ due[d], begin, std::min (begin + TASK_BINS, segments[(size_t) due[d]].bins) });
+    auto products = [this] (int t) {
+        const Task& task = tasks[(size_t) t];
+        multiply(segments[(size_t) task.segment], task.begin, task.end);
+    };
+    scheduler->run((int) tasks.size(), products);
+
+    auto output = [this, &due] (int d) { transformOutput(segments[(size_t) due[d]]); };
+    scheduler->run(numDue, output);
+}
+
+void PsxVerbConvolver::transformInput(Segment& segment) {
+    const KernelSegment& k = *segment.kernel;
+    const int size = segment.size;
+    const int fftSize = 2 * size;
+    float* re = segment.fft_re.data();
+    float* im = segment.fft_im.data();
+
+    // Overlap-save window of the input delayed by the segment's offset,
+    // ending where this block does. The offset is at least the block size,
+    // so all of it has arrived. Left goes in as the real part and right as
+    // the imaginary, one transform for both.
+    const uint64_t start = position + (uint64_t) size - (uint64_t) k.offset - (uint64_t) fftSize;
+    for (int n = 0; n < fftSize; n++) {
+        const auto index = (size_t) ((start + (uint64_t) n) & history_mask);
+        re[n] = history_left[index];
+        im[n] = history_right[index];
+    }
+    k.fft.forward(re, im);
+
+    // Split the two real inputs' spectra apart by their conjugate symmetry,
+    // leaving out the halving
+    segment.slot = segment.slot + 1 == k.parts ? 0 : segment.slot + 1;
+    const auto at = (size_t) (segment.slot * segment.bins);
+    float* leftRe = segment.left_re.data() + at;
+    float* leftIm = segment.left_im.data() + at;
+    float* rightRe = segment.right_re.data() + at;
+    float* rightIm = segment.right_im.data() + at;
+    for (int bin = 0; bin < segment.bins; bin++) {
+        const int mirror = (fftSize - bin) & (fftSize - 1);
+        leftRe[bin] = re[bin] + re[mirror];
+        leftIm[bin] = im[bin] - im[mirror];
+        rightRe[bin] = im[bin] + im[mirror];
+        rightIm[bin] = re[mirror] - re[bin];
+    }
+}
+
+void PsxVerbConvolver::multiply(Segment& segment, int begin, int end) {
+    const KernelSegment& k = *segment.kernel;
+    const int bins = segment.bins;
+
+    std::fill (segment.out_left_re.begin() + begin, segment.out_left_re.begin() + end, 0.0f);
+    std::fill (segment.out_left_im.begin() + begin, segment.out_left_im.begin() + end, 0.0f);
+    std::fill (segment.out_right_re.begin() + begin, segment.out_right_re.begin() + end, 0.0f);
+    std::fill (segment.out_right_im.begin() + begin, segment.out_right_im.begin() + end, 0.0f);
+    float* outLeftRe = segment.out_left_re.data();
+    float* outLeftIm = segment.out_left_im.data();
+    float* outRightRe = segment.out_right_re.data();
+    float* outRightIm = segment.out_right_im.data();
+
+    // Partition p meets the input block from p blocks ago
+    for (int part = 0; part < k.parts; part++) {
+        const int slot = (segment.slot - part + k.parts) % k.parts;
+        const float* xlr = segment.left_re.data() + slot * bins;
+        const float* xli = segment.left_im.data() + slot * bins;
+        const float* xrr = segment.right_re.data() + slot * bins;
+        const float* xri = segment.right_im.data() + slot * bins;
+
+        const float* hr = k.re.data() + part * NUM_PATHS * bins;
+        const float* hi = k.im.data() + part * NUM_PATHS * bins;
+        multiplyAdd(outLeftRe, outLeftIm, hr + LL * bins, hi + LL * bins, xlr, xli, begin, end);
+        multiplyAdd(outLeftRe, outLeftIm, hr + RL * bins, hi + RL * bins, xrr, xri, begin, end);
+        multiplyAdd(outRightRe, outRightIm, hr + LR * bins, hi + LR * bins, xlr, xli, begin, end);
+        multiplyAdd(outRightRe, outRightIm, hr + RR * bins, hi + RR * bins, xrr, xri, begin, end);
+    }
+}
+
+void PsxVerbConvolver::transformOutput(Segment& segment) {
+    const KernelSegment& k = *segment.kernel;
+    const int size = segment.size;
+    const int fftSize = 2 * size;
+    float* re = segment.fft_re.data();
+    float* im = segment.fft_im.data();
+    const float* leftRe = segment.out_left_re.data();
+    const float* leftIm = segment.out_left_im.data();
+    const float* rightRe = segment.out_right_re.data();
+    const float* rightIm = segment.out_right_im.data();
+
+    // Both outputs are real, so left + i right rebuilds the whole spectrum
+    // from the kept half and comes out of one inverse transform
+    for (int bin = 0; bin <= size; bin++) {
+        re[bin] = leftRe[bin] - rightIm[bin];
+        im[bin] = leftIm[bin] + rightRe[bin];
+    }
+    for (int bin = 1; bin < size; bin++) {
+        re[fftSize - bin] = leftRe[bin] + rightIm[bin];
+        im[fftSize - bin] = rightRe[bin] - leftIm[bin];
+    }
+    k.fft.inverse(re, im);
+
+    // The second half is the part of the overlap-save result that's valid
+    std::copy (re + size, re + fftSize, segment.out_left.begin());
+    std::copy (im + size, im + fftSize, segment.out_right.begin());
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "ReverbScheduler.h"
+#include "SplitFft.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Another engine behind PsxVerb's interface for offline and many-channel
+// work. With fixed gains a float PsxVerb preset is a linear, time-invariant
+// stereo system, so it can be run as four impulse responses (left and right
+// in to left and right out) instead of the feedback network. Each preset's
+// responses are rendered once per rate through a PsxVerb, cut off at
+// getTailSeconds() or the maximum tail, and shared between every convolver
+// that uses them.
+//
+// The convolution is partitioned non-uniformly and has no latency: the first
+// HEAD_SIZE taps run directly in the time domain, the rest in FFT segments
+// whose partitions double in size further into the response, each starting
+// late enough to be computed at the start of its own block. Segment blocks
+// that fall due together can be split over worker threads.
+//
+// The network's output differs from the convolution's by the cut-off tail
+// and float rounding, well below -100 dB. The fixed engine and native-rate
+// mode aren't linear and time-invariant, so they have no equivalent here.
+class PsxVerbConvolver {
+public:
+    // Taps run directly, and the first segment's partition size
+    static constexpr int HEAD_SIZE = 64;
+    // Partitions grow no larger than this; the last segment has as many as
+    // the rest of the response needs
+    static constexpr int MAX_PARTITION = 8192;
+
+    PsxVerbConvolver();
+    ~PsxVerbConvolver();
+
+    // Clears the history. Renders the preset's responses for the new rate if
+    // no convolver has yet, so not real-time safe.
+    void init(float sampleRate);
+    // As init(): renders on first use for this rate, and clears the history
+    void setPreset(int presetIndex);
+    void setWetGain(float newWet);
+    void setDryGain(float newDry);
+    void setMasterGain(float gain);
+
+    // Longest response rendered, for Chaos Echo's endless one and anything
+    // else that rings on past it. Takes effect on the next init() or
+    // setPreset().
+    void setMaxTailSeconds(float seconds);
+    // Threads besides the caller to share segment blocks with, 0 for none.
+    // Starts and stops threads, so call it outside process().
+    void setNumWorkers(int numWorkers);
+
+    void process(float* leftBuffer, float* rightBuffer, int numSamples);
+
+    // Samples of each response convolved
+    int getResponseLength() const;
+
+private:
+    struct Kernel;
+    struct KernelSegment;
+
+    // A segment's FFT state and output
+    struct Segment {
+        const KernelSegment* kernel = nullptr;
+        int size = 0;
+        // Bins kept of each real spectrum, size + 1
+        int bins = 0;
+        // Input spectra of the last parts blocks, one slot per block
+        std::vector<float> left_re, left_im, right_re, right_im;
+        int slot = 0;
+        // Output spectra, and the transform's working space
+        std::vector<float> out_left_re, out_left_im, out_right_re, out_right_im;
+        std::vector<float> fft_re, fft_im;
+        // The block that plays over the segment's next size samples
+        std::vector<float> out_left, out_right;
+    };
+
+    // A share of one block boundary's work for a thread
+    struct Task {
+        int segment;
+        int begin, end;
+    };
+
+    static std::shared_ptr<const Kernel> getKernel(int presetIndex, float sampleRate, int length);
+    static std::shared_ptr<const Kernel> renderKernel(int presetIndex, float sampleRate, int length);
+
+    void loadKernel();
+    void startBlock();
+    void transformInput(Segment& segment);
+    void multiply(Segment& segment, int begin, int end);
+    void transformOutput(Segment& segment);
+
+    // Below this a boundary's blocks are too small to be worth waking threads for
+    static constexpr int PARALLEL_SIZE = 1024;
+    // Bins of one segment's multiply-accumulate per task
+    static constexpr int TASK_BINS = 512;
+    // Segment sizes run from HEAD_SIZE up to MAX_PARTITION
+    static constexpr int MAX_SEGMENTS = 8;
+    static_assert ((HEAD_SIZE << (MAX_SEGMENTS - 1)) == MAX_PARTITION);
+    static constexpr int MAX_TASKS = MAX_SEGMENTS * (MAX_PARTITION / TASK_BINS + 1);
+
+    float rate = 0.0f;
+    int preset_index = 0;
+    float max_tail_seconds = 10.0f;
+    float wet = 1.0f, dry = 1.0f, master = 1.0f;
+
+    std::shared_ptr<const Kernel> kernel;
+    std::vector<Segment> segments;
+
+    // Input history for the segments, and the last two head blocks for the
+    // direct taps
+    std::vector<float> history_left, history_right;
+    uint32_t history_mask = 0;
+    float head_left[2 * HEAD_SIZE], head_right[2 * HEAD_SIZE];
+    uint64_t position = 0;
+
+    std::unique_ptr<ReverbScheduler> scheduler;
+    std::vector<Task> tasks;
+};
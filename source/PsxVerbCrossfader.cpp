@@ -0,0 +1,210 @@
+#include "PsxVerbCrossfader.h"
+#include <limits>
+
+void PsxVerbCrossfader::init(float sampleRate) {
+    engines[0].init(sampleRate);
+    engines[1].init(sampleRate);
+
+    // A preset chosen before playback starts needs no fade
+    if (pending_preset >= 0) {
+        preset_index = pending_preset;
+        pending_preset = -1;
+    }
+    engines[active].setPreset(preset_index);
+
+    fade_samples = std::max (1, (int) (sampleRate * FADE_SECONDS));
+    fade_remaining = 0;
+    spare_clean = true;
+}
+
+void PsxVerbCrossfader::setMaxSampleRate(float maxSampleRate) {
+    engines[0].setMaxSampleRate(maxSampleRate);
+    engines[1].setMaxSampleRate(maxSampleRate);
+}
+
+void PsxVerbCrossfader::process(float* leftBuffer, float* rightBuffer, int numSamples) {
+    if (pending_preset >= 0 && fade_remaining == 0 && spare_clean)
+        startSwitch();
+
+    PsxVerb& old = engines[1 - active];
+    if (fade_remaining == 0) {
+        engines[active].process(leftBuffer, rightBuffer, numSamples);
+        if (!spare_clean)
+            spare_clean = old.clearSome(CLEAR_SLICE);
+        return;
+    }
+
+    // Both engines take the input while their outputs crossfade. The dry
+    // signal goes through both, so a change into or out of Off (which mutes
+    // it) fades as well.
+    float oldL[CHUNK_MAX], oldR[CHUNK_MAX];
+    const float step = 1.0f / (float) fade_samples;
+
+    int done = 0;
+    while (done < numSamples && fade_remaining > 0) {
+        const int n = std::min ({ CHUNK_MAX, numSamples - done, fade_remaining });
+        float* left = leftBuffer + done;
+        float* right = rightBuffer + done;
+
+        std::copy (left, left + n, oldL);
+        std::copy (right, right + n, oldR);
+        old.process(oldL, oldR, n);
+        engines[active].process(left, right, n);
+
+        // Both sides are read before either is written, as the buffers
+        // may be the same one for mono input
+        float gain = (float) fade_remaining * step;
+        for (int i = 0; i < n; i++) {
+            gain -= step;
+            const float l = left[i] + (oldL[i] - left[i]) * gain;
+            const float r = right[i] + (oldR[i] - right[i]) * gain;
+            left[i] = l;
+            right[i] = r;
+        }
+
+        fade_remaining -= n;
+        done += n;
+    }
+
+    if (fade_remaining == 0) {
+        old.startClearing();
+        if (done < numSamples)
+            engines[active].process(leftBuffer + done, rightBuffer + done, numSamples - done);
+    }
+}
+
+void PsxVerbCrossfader::processSpeakers(float* const* channels, int numSamples) {
+    if (pending_preset >= 0 && fade_remaining == 0 && spare_clean)
+        startSwitch();
+
+    PsxVerb& old = engines[1 - active];
+    if (fade_remaining == 0) {
+        engines[active].processSpeakers(channels, numSamples);
+        if (!spare_clean)
+            spare_clean = old.clearSome(CLEAR_SLICE);
+        return;
+    }
+
+    // As process(), one copy of the input per speaker for the old engine
+    const int count = engines[active].getNumSpeakers();
+    float oldBus[PsxVerb::MAX_SPEAKERS][SPEAKER_CHUNK];
+    float* oldChannels[PsxVerb::MAX_SPEAKERS];
+    float* newChannels[PsxVerb::MAX_SPEAKERS];
+    const float step = 1.0f / (float) fade_samples;
+
+    int done = 0;
+    while (done < numSamples && fade_remaining > 0) {
+        const int n = std::min ({ SPEAKER_CHUNK, numSamples - done, fade_remaining });
+        for (int c = 0; c < count; c++) {
+            newChannels[c] = channels[c] + done;
+            oldChannels[c] = oldBus[c];
+            std::copy (newChannels[c], newChannels[c] + n, oldBus[c]);
+        }
+        old.processSpeakers(oldChannels, n);
+        engines[active].processSpeakers(newChannels, n);
+
+        for (int c = 0; c < count; c++) {
+            float* channel = newChannels[c];
+            float gain = (float) fade_remaining * step;
+            for (int i = 0; i < n; i++) {
+                gain -= step;
+                channel[i] += (oldBus[c][i] - channel[i]) * gain;
+            }
+        }
+
+        fade_remaining -= n;
+        done += n;
+    }
+
+    if (fade_remaining == 0) {
+        old.startClearing();
+        if (done < numSamples) {
+            for (int c = 0; c < count; c++)
+                newChannels[c] = channels[c] + done;
+            engines[active].processSpeakers(newChannels, numSamples - done);
+        }
+    }
+}
+
+double PsxVerbCrossfader::getTailSeconds() const {
+    if (ringsForever())
+        return std::numeric_limits<double>::infinity();
+    if (fade_remaining > 0)
+        return std::max (engines[0].getTailSeconds(), engines[1].getTailSeconds());
+    return engines[active].getTailSeconds();
+}
+
+bool PsxVerbCrossfader::ringsForever() const {
+    if (fade_remaining > 0)
+        return engines[0].ringsForever() || engines[1].ringsForever();
+    return engines[active].ringsForever();
+}
+
+bool PsxVerbCrossfader::scanRing(uint32_t maxCells, PsxVerb::RingEnergy& energy) {
+    return engines[active].scanRing(maxCells, energy);
+}
+
+PsxVerb::Levels PsxVerbCrossfader::takeLevels() {
+    // The idle engine's would only be stale
+    engines[1 - active].takeLevels();
+    return engines[active].takeLevels();
+}
+
+void PsxVerbCrossfader::startSwitch() {
+    active = 1 - active;
+    engines[active].setPreset(pending_preset);
+    preset_index = pending_preset;
+    pending_preset = -1;
+
+    fade_remaining = fade_samples;
+    spare_clean = false;
+}
+
+void PsxVerbCrossfader::setPreset(int presetIndex) {
+    if (presetIndex == preset_index)
+        pending_preset = -1;
+    else
+        pending_preset = presetIndex;
+}
+
+void PsxVerbCrossfader::setWetGain(float newWet) {
+    engines[0].setWetGain(newWet);
+    engines[1].setWetGain(newWet);
+}
+
+void PsxVerbCrossfader::setDryGain(float newDry) {
+    engines[0].setDryGain(newDry);
+    engines[1].setDryGain(newDry);
+}
+
+void PsxVerbCrossfader::setGains(float newWet, float newDry, int rampSamples) {
+    // The idle engine doesn't process, so its ramp wouldn't move; it just
+    // takes the new gains for its next preset
+    engines[active].setGains(newWet, newDry, rampSamples);
+    engines[1 - active].setGains(newWet, newDry, fade_remaining > 0 ? rampSamples : 0);
+}
+
+void PsxVerbCrossfader::setMasterGain(float gain) {
+    engines[0].setMasterGain(gain);
+    engines[1].setMasterGain(gain);
+}
+
+void PsxVerbCrossfader::setNativeRate(bool shouldRunNative) {
+    engines[0].setNativeRate(shouldRunNative);
+    engines[1].setNativeRate(shouldRunNative);
+}
+
+void PsxVerbCrossfader::setEngine(PsxVerb::Engine newEngine) {
+    engines[0].setEngine(newEngine);
+    engines[1].setEngine(newEngine);
+}
+
+void PsxVerbCrossfader::setLayout(PsxVerb::Layout newLayout) {
+    engines[0].setLayout(newLayout);
+    engines[1].setLayout(newLayout);
+}
+
+void PsxVerbCrossfader::setSpeakers(const PsxVerb::Speaker* speakers, int count) {
+    engines[0].setSpeakers(speakers, count);
+    engines[1].setSpeakers(speakers, count);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "PsxVerb.h"
+
+// Two PsxVerb engines behind PsxVerb's own interface, so a preset change
+// crossfades instead of clearing a ring on the audio thread. The new preset
+// starts on the spare engine's clean ring and fades in over the old engine,
+// whose ring is then cleared a slice per block, ready for the next change.
+// Presets requested before that are held back until it is.
+class PsxVerbCrossfader {
+public:
+    void init(float sampleRate);
+    void setMaxSampleRate(float maxSampleRate);
+
+    void process(float* leftBuffer, float* rightBuffer, int numSamples);
+    void processSpeakers(float* const* channels, int numSamples);
+    void setPreset(int presetIndex);
+    void setWetGain(float newWet);
+    void setDryGain(float newDry);
+    void setMasterGain(float gain);
+    void setGains(float newWet, float newDry, int rampSamples);
+    void setNativeRate(bool shouldRunNative);
+    void setEngine(PsxVerb::Engine newEngine);
+    void setLayout(PsxVerb::Layout newLayout);
+    void setSpeakers(const PsxVerb::Speaker* speakers, int count);
+
+    // The longer of both presets' tails while they crossfade
+    double getTailSeconds() const;
+    // Whether either preset repeats forever while they crossfade, see PsxVerb
+    bool ringsForever() const;
+    // The active engine's, see PsxVerb
+    bool scanRing(uint32_t maxCells, PsxVerb::RingEnergy& energy);
+    PsxVerb::Levels takeLevels();
+
+private:
+    static constexpr float FADE_SECONDS = 0.2f;
+    // Ring cells the idle engine clears per process() call
+    static constexpr uint32_t CLEAR_SLICE = 16384;
+    static constexpr int CHUNK_MAX = 512;
+    // Shorter for processSpeakers(), which keeps a copy of every channel
+    static constexpr int SPEAKER_CHUNK = 128;
+
+    void startSwitch();
+
+    PsxVerb engines[2];
+    int active = 0;
+
+    int preset_index = 0;
+    // Next preset to switch to, -1 when there is none
+    int pending_preset = -1;
+
+    int fade_samples = 0;
+    int fade_remaining = 0;
+    bool spare_clean = true;
+};
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define PSXVERB_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define PSXVERB_NEON 1
+#endif
+
+// Four float lanes, one SSE2/NEON register where available.
+// Used to run the L/R (and SAME/DIFF) halves of the network as one vector.
+struct Lanes4
+{
+#if PSXVERB_SSE2
+    __m128 v;
+
+    static Lanes4 load (const float* p) { return { _mm_loadu_ps (p) }; }
+    static Lanes4 set (float a, float b, float c, float d) { return { _mm_setr_ps (a, b, c, d) }; }
+    static Lanes4 broadcast (float a) { return { _mm_set1_ps (a) }; }
+    void store (float* p) const { _mm_storeu_ps (p, v); }
+    float sum() const
+    {
+        const __m128 pairs = _mm_add_ps (v, _mm_movehl_ps (v, v));
+        return _mm_cvtss_f32 (_mm_add_ss (pairs, _mm_shuffle_ps (pairs, pairs, 1)));
+    }
+
+    friend Lanes4 operator+ (Lanes4 a, Lanes4 b) { return { _mm_add_ps (a.v, b.v) }; }
+    friend Lanes4 operator- (Lanes4 a, Lanes4 b) { return { _mm_sub_ps (a.v, b.v) }; }
+    friend Lanes4 operator* (Lanes4 a, Lanes4 b) { return { _mm_mul_ps (a.v, b.v) }; }
+
+    // std::round for each lane. From 2^23 up every float is whole; larger
+    // magnitudes (and NaN) come back as 2^23.
+    Lanes4 round() const
+    {
+        const __m128 sign = _mm_set1_ps (-0.0f);
+        const __m128 magnitude = _mm_min_ps (_mm_andnot_ps (sign, v), _mm_set1_ps (8388608.0f));
+        const __m128 whole = _mm_cvtepi32_ps (_mm_cvttps_epi32 (magnitude));
+        // The fraction is exact, so doubling it and truncating tells a half
+        const __m128 up = _mm_cvtepi32_ps (_mm_cvttps_epi32 (_mm_add_ps (_mm_sub_ps (magnitude, whole), _mm_sub_ps (magnitude, whole))));
+        return { _mm_or_ps (_mm_add_ps (whole, up), _mm_and_ps (sign, v)) };
+    }
+
+    Lanes4 abs() const { return { _mm_andnot_ps (_mm_set1_ps (-0.0f), v) }; }
+    friend Lanes4 max (Lanes4 a, Lanes4 b) { return { _mm_max_ps (a.v, b.v) }; }
+    float maxLane() const
+    {
+        const __m128 pairs = _mm_max_ps (v, _mm_movehl_ps (v, v));
+        return _mm_cvtss_f32 (_mm_max_ss (pairs, _mm_shuffle_ps (pairs, pairs, 1)));
+    }
+#elif PSXVERB_NEON
+    float32x4_t v;
+
+    static Lanes4 load (const float* p) { return { vld1q_f32 (p) }; }
+    static Lanes4 set (float a, float b, float c, float d)
+    {
+        const float lanes[4] = { a, b, c, d };
+        return { vld1q_f32 (lanes) };
+    }
+    static Lanes4 broadcast (float a) { return { vdupq_n_f32 (a) }; }
+    void store (float* p) const { vst1q_f32 (p, v); }
+    float sum() const
+    {
+        const float32x2_t pairs = vadd_f32 (vget_low_f32 (v), vget_high_f32 (v));
+        return vget_lane_f32 (vpadd_f32 (pairs, pairs), 0);
+    }
+
+    friend Lanes4 operator+ (Lanes4 a, Lanes4 b) { return { vaddq_f32 (a.v, b.v) }; }
+    friend Lanes4 operator- (Lanes4 a, Lanes4 b) { return { vsubq_f32 (a.v, b.v) }; }
+    friend Lanes4 operator* (Lanes4 a, Lanes4 b) { return { vmulq_f32 (a.v, b.v) }; }
+
+    Lanes4 round() const
+    {
+        const float32x4_t magnitude = vminq_f32 (vabsq_f32 (v), vdupq_n_f32 (8388608.0f));
+        const float32x4_t whole = vcvtq_f32_s32 (vcvtq_s32_f32 (magnitude));
+        const float32x4_t fraction = vsubq_f32 (magnitude, whole);
+        const float32x4_t up = vcvtq_f32_s32 (vcvtq_s32_f32 (vaddq_f32 (fraction, fraction)));
+        const uint32x4_t sign = vandq_u32 (vreinterpretq_u32_f32 (v), vdupq_n_u32 (0x80000000u));
+        return { vreinterpretq_f32_u32 (vorrq_u32 (vreinterpretq_u32_f32 (vaddq_f32 (whole, up)), sign)) };
+    }
+
+    Lanes4 abs() const { return { vabsq_f32 (v) }; }
+    friend Lanes4 max (Lanes4 a, Lanes4 b) { return { vmaxq_f32 (a.v, b.v) }; }
+    float maxLane() const
+    {
+        const float32x2_t pairs = vmax_f32 (vget_low_f32 (v), vget_high_f32 (v));
+        return vget_lane_f32 (vpmax_f32 (pairs, pairs), 0);
+    }
+#else
+    float v[4];
+
+    static Lanes4 load (const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+    static Lanes4 set (float a, float b, float c, float d) { return { { a, b, c, d } }; }
+    static Lanes4 broadcast (float a) { return { { a, a, a, a } }; }
+    void store (float* p) const
+    {
+        for (int i = 0; i < 4; i++)
+            p[i] = v[i];
+    }
+    float sum() const { return (v[0] + v[1]) + (v[2] + v[3]); }
+
+    friend Lanes4 operator+ (Lanes4 a, Lanes4 b) { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+    friend Lanes4 operator- (Lanes4 a, Lanes4 b) { return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+    friend Lanes4 operator* (Lanes4 a, Lanes4 b) { return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+
+    Lanes4 round() const { return { { std::round (v[0]), std::round (v[1]), std::round (v[2]), std::round (v[3]) } }; }
+
+    Lanes4 abs() const { return { { std::abs (v[0]), std::abs (v[1]), std::abs (v[2]), std::abs (v[3]) } }; }
+    friend Lanes4 max (Lanes4 a, Lanes4 b) { return { { std::max (a.v[0], b.v[0]), std::max (a.v[1], b.v[1]), std::max (a.v[2], b.v[2]), std::max (a.v[3], b.v[3]) } }; }
+    float maxLane() const { return std::max (std::max (v[0], v[1]), std::max (v[2], v[3])); }
+#endif
+};
+
+// Eight int16 lanes for the fixed-point engine, and their products at 32 bits.
+// Products shift down by 15 and truncate like the SPU's multiplier, sums stay
+// at 32 bits and only saturate back to 16 when narrowed.
+struct Samples8
+{
+#if PSXVERB_SSE2
+    __m128i v;
+
+    static Samples8 load (const int16_t* p) { return { _mm_loadu_si128 ((const __m128i*) p) }; }
+    static Samples8 broadcast (int16_t a) { return { _mm_set1_epi16 (a) }; }
+    void store (int16_t* p) const { _mm_storeu_si128 ((__m128i*) p, v); }
+#elif PSXVERB_NEON
+    int16x8_t v;
+
+    static Samples8 load (const int16_t* p) { return { vld1q_s16 (p) }; }
+    static Samples8 broadcast (int16_t a) { return { vdupq_n_s16 (a) }; }
+    void store (int16_t* p) const { vst1q_s16 (p, v); }
+#else
+    int16_t v[8];
+
+    static Samples8 load (const int16_t* p)
+    {
+        Samples8 s;
+        for (int i = 0; i < 8; i++)
+            s.v[i] = p[i];
+        return s;
+    }
+    static Samples8 broadcast (int16_t a)
+    {
+        Samples8 s;
+        for (int i = 0; i < 8; i++)
+            s.v[i] = a;
+        return s;
+    }
+    void store (int16_t* p) const
+    {
+        for (int i = 0; i < 8; i++)
+            p[i] = v[i];
+    }
+#endif
+};
+
+struct Wide8
+{
+#if PSXVERB_SSE2
+    __m128i lo, hi;
+
+    static Wide8 widen (Samples8 a)
+    {
+        return { _mm_srai_epi32 (_mm_unpacklo_epi16 (a.v, a.v), 16), _mm_srai_epi32 (_mm_unpackhi_epi16 (a.v, a.v), 16) };
+    }
+    // No 16x16->32 multiply in SSE2, so the halves of each product are interleaved back together
+    static Wide8 product (Samples8 a, Samples8 b)
+    {
+        const __m128i low = _mm_mullo_epi16 (a.v, b.v);
+        const __m128i high = _mm_mulhi_epi16 (a.v, b.v);
+        return { _mm_srai_epi32 (_mm_unpacklo_epi16 (low, high), 15), _mm_srai_epi32 (_mm_unpackhi_epi16 (low, high), 15) };
+    }
+    Samples8 saturate() const { return { _mm_packs_epi32 (lo, hi) }; }
+
+    friend Wide8 operator+ (Wide8 a, Wide8 b) { return { _mm_add_epi32 (a.lo, b.lo), _mm_add_epi32 (a.hi, b.hi) }; }
+    friend Wide8 operator- (Wide8 a, Wide8 b) { return { _mm_sub_epi32 (a.lo, b.lo), _mm_sub_epi32 (a.hi, b.hi) }; }
+#elif PSXVERB_NEON
+    int32x4_t lo, hi;
+
+    static Wide8 widen (Samples8 a) { return { vmovl_s16 (vget_low_s16 (a.v)), vmovl_s16 (vget_high_s16 (a.v)) }; }
+    static Wide8 product (Samples8 a, Samples8 b)
+    {
+        return { vshrq_n_s32 (vmull_s16 (vget_low_s16 (a.v), vget_low_s16 (b.v)), 15),
+                 vshrq_n_s32 (vmull_s16 (vget_high_s16 (a.v), vget_high_s16 (b.v)), 15) };
+    }
+    Samples8 saturate() const { return { vcombine_s16 (vqmovn_s32 (lo), vqmovn_s32 (hi)) }; }
+
+    friend Wide8 operator+ (Wide8 a, Wide8 b) { return { vaddq_s32 (a.lo, b.lo), vaddq_s32 (a.hi, b.hi) }; }
+    friend Wide8 operator- (Wide8 a, Wide8 b) { return { vsubq_s32 (a.lo, b.lo), vsubq_s32 (a.hi, b.hi) }; }
+#else
+    int32_t v[8];
+
+    static Wide8 widen (Samples8 a)
+    {
+        Wide8 w;
+        for (int i = 0; i < 8; i++)
+            w.v[i] = a.v[i];
+        return w;
+    }
+    static Wide8 product (Samples8 a, Samples8 b)
+    {
+        Wide8 w;
+        for (int i = 0; i < 8; i++)
+            w.v[i] = ((int32_t) a.v[i] * b.v[i]) >> 15;
+        return w;
+    }
+    Samples8 saturate() const
+    {
+        Samples8 s;
+        for (int i = 0; i < 8; i++)
+            s.v[i] = (int16_t) (v[i] < -32768 ? -32768 : v[i] > 32767 ? 32767 : v[i]);
+        return s;
+    }
+
+    friend Wide8 operator+ (Wide8 a, Wide8 b)
+    {
+        for (int i = 0; i < 8; i++)
+            a.v[i] += b.v[i];
+        return a;
+    }
+    friend Wide8 operator- (Wide8 a, Wide8 b)
+    {
+        for (int i = 0; i < 8; i++)
+            a.v[i] -= b.v[i];
+        return a;
+    }
+#endif
+};
@@ -0,0 +1,136 @@
+#include "ReverbScheduler.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+#endif
+
+namespace
+{
+    void spinPause()
+    {
+#if defined(__SSE2__) || defined(_M_X64)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    uint64_t pack (uint32_t next, uint32_t end)
+    {
+        return (uint64_t) end << 32 | next;
+    }
+}
+
+ReverbScheduler::ReverbScheduler(int numWorkers, int maxTasks)
+    : num_threads (numWorkers + 1),
+      ranges (std::make_unique<Range[]> ((size_t) (numWorkers + 1))),
+      skipped ((size_t) maxTasks, 0)
+{
+    workers.reserve ((size_t) numWorkers);
+    for (int w = 1; w <= numWorkers; w++)
+        workers.emplace_back ([this, w] { workerLoop(w); });
+}
+
+ReverbScheduler::~ReverbScheduler() {
+    quit.store(true);
+    epoch.fetch_add(1);
+    epoch.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+int ReverbScheduler::runTasks(int numTasks, TaskFunction function, void* context, Clock::time_point deadline) {
+    if (numTasks <= 0)
+        return 0;
+
+    task_function = function;
+    task_context = context;
+    task_deadline = deadline;
+    abandon.store(false, std::memory_order_relaxed);
+    std::fill (skipped.begin(), skipped.begin() + numTasks, 0);
+    remaining.store(numTasks, std::memory_order_relaxed);
+
+    // Publishing the ranges publishes everything above, claims acquire them
+    for (int t = 0; t < num_threads; t++) {
+        const auto begin = (uint32_t) ((int64_t) numTasks * t / num_threads);
+        const auto end = (uint32_t) ((int64_t) numTasks * (t + 1) / num_threads);
+        ranges[(size_t) t].cursor.store(pack (begin, end), std::memory_order_release);
+    }
+
+    epoch.fetch_add(1, std::memory_order_release);
+    epoch.notify_all();
+
+    work(0, true);
+
+    // Barrier: whatever is still running has to finish, but nothing new
+    // starts once the deadline has gone. Yield after a while in case the
+    // thread we wait for shares our core.
+    for (int spin = 0; remaining.load(std::memory_order_acquire) > 0; spin++) {
+        if (Clock::now() >= deadline)
+            abandon.store(true, std::memory_order_relaxed);
+        if (spin < 256)
+            spinPause();
+        else
+            std::this_thread::yield();
+    }
+
+    int numSkipped = 0;
+    for (int i = 0; i < numTasks; i++)
+        numSkipped += skipped[(size_t) i];
+    return numSkipped;
+}
+
+void ReverbScheduler::workerLoop(int self) {
+    // A worker that only starts once the scheduler is being destroyed has
+    // missed the wake-up, and would wait for an epoch that never comes
+    uint32_t seen = epoch.load(std::memory_order_acquire);
+    if (quit.load())
+        return;
+
+    for (;;) {
+        // Spin briefly for the next block before going to sleep
+        for (int spin = 0; spin < 4096 && epoch.load(std::memory_order_acquire) == seen; spin++)
+            spinPause();
+        epoch.wait(seen, std::memory_order_acquire);
+        seen = epoch.load(std::memory_order_acquire);
+
+        if (quit.load())
+            return;
+
+        work(self, false);
+    }
+}
+
+bool ReverbScheduler::claim(int victim, int& index) {
+    auto& cursor = ranges[(size_t) victim].cursor;
+    uint64_t current = cursor.load(std::memory_order_acquire);
+    for (;;) {
+        const auto next = (uint32_t) current;
+        const auto end = (uint32_t) (current >> 32);
+        if (next >= end)
+            return false;
+        if (cursor.compare_exchange_weak(current, pack (next + 1, end), std::memory_order_acq_rel, std::memory_order_acquire)) {
+            index = (int) next;
+            return true;
+        }
+    }
+}
+
+void ReverbScheduler::work(int self, bool isCaller) {
+    int index;
+    for (int v = 0; v < num_threads; v++) {
+        // Own range first, then steal from the others in turn
+        const int victim = (self + v) % num_threads;
+        while (claim(victim, index)) {
+            if (isCaller && Clock::now() >= task_deadline)
+                abandon.store(true, std::memory_order_relaxed);
+
+            if (abandon.load(std::memory_order_relaxed))
+                skipped[(size_t) index] = 1;
+            else
+                task_function(task_context, index);
+
+            remaining.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+}
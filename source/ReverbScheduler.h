@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Runs a block's worth of independent tasks (typically one PsxVerb::process
+// call each) on the calling thread plus a pool of workers. Every block the
+// tasks are split into one contiguous range per thread; a thread works
+// through its own range and then steals from the others', all through
+// lock-free claims. The calling thread doubles as the barrier: once the
+// deadline passes, tasks nobody has started yet are skipped instead of run,
+// and it only waits for the ones already in flight.
+//
+// Threads are created in the constructor. run() itself takes no locks and
+// allocates nothing; idle workers sleep on an atomic wait.
+class ReverbScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // numWorkers threads besides the caller; maxTasks bounds every run()
+    ReverbScheduler(int numWorkers, int maxTasks);
+    ~ReverbScheduler();
+
+    ReverbScheduler(const ReverbScheduler&) = delete;
+    ReverbScheduler& operator=(const ReverbScheduler&) = delete;
+
+    // Calls task(i) once for each i in [0, numTasks) unless the deadline
+    // passes first. Returns how many tasks were skipped, see wasSkipped().
+    template <typename Task>
+    int run(int numTasks, Task& task, Clock::time_point deadline = Clock::time_point::max())
+    {
+        return runTasks(numTasks, [] (void* context, int index) { (*static_cast<Task*> (context))(index); }, &task, deadline);
+    }
+
+    bool wasSkipped(int task) const { return skipped[(size_t) task] != 0; }
+    int getNumThreads() const { return num_threads; }
+
+private:
+    using TaskFunction = void (*) (void* context, int index);
+
+    // A thread's share of the block, next task in the low half and end in the
+    // high half, so both change together in one compare-and-swap
+    struct alignas (64) Range {
+        std::atomic<uint64_t> cursor { 0 };
+    };
+
+    int runTasks(int numTasks, TaskFunction function, void* context, Clock::time_point deadline);
+    void workerLoop(int self);
+    void work(int self, bool isCaller);
+    bool claim(int victim, int& index);
+
+    int num_threads;
+    std::unique_ptr<Range[]> ranges;
+    std::vector<uint8_t> skipped;
+    std::vector<std::thread> workers;
+
+    TaskFunction task_function = nullptr;
+    void* task_context = nullptr;
+    Clock::time_point task_deadline;
+
+    alignas (64) std::atomic<uint32_t> epoch { 0 };
+    alignas (64) std::atomic<int> remaining { 0 };
+    std::atomic<bool> abandon { false };
+    std::atomic<bool> quit { false };
+};
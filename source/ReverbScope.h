@@ -0,0 +1,122 @@
+#pragma once
+
+#include "ScopeFeed.h"
+#include <juce_gui_basics/juce_gui_basics.h>
+
+// Live view of the reverb for the editor: a bar per delay line showing how
+// much energy its stretch of ring holds, and dry and wet level meters.
+// Polls the feed's FIFO on a timer and repaints only the bars that moved
+// by at least a pixel, so a busy session costs the message thread little.
+class ReverbScope : public juce::Component, private juce::Timer
+{
+public:
+    explicit ReverbScope (ScopeFeed& source)
+        : feed (source)
+    {
+        setOpaque (true);
+        feed.setListening (true);
+        startTimerHz (ScopeFeed::SNAPSHOT_HZ);
+    }
+
+    ~ReverbScope() override
+    {
+        feed.setListening (false);
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        g.fillAll (juce::Colour (0xff101418));
+
+        static const char* const names[PsxVerb::NUM_REGIONS] = { "L same", "R same", "L diff", "R diff", "L apf1", "R apf1", "L apf2", "R apf2" };
+        g.setFont (10.0f);
+        for (int region = 0; region < PsxVerb::NUM_REGIONS; ++region)
+        {
+            const auto column = regionBounds (region);
+            g.setColour (juce::Colours::darkslategrey);
+            g.fillRect (column.withTop (column.getBottom() - bars[region]));
+            g.setColour (juce::Colours::lightgrey);
+            g.drawText (names[region], column.withTop (column.getBottom() - 12), juce::Justification::centred, false);
+        }
+
+        for (int meter = 0; meter < 2; ++meter)
+        {
+            const auto row = meterBounds (meter);
+            g.setColour (meter == 0 ? juce::Colours::steelblue : juce::Colours::seagreen);
+            g.fillRect (row.withWidth (meters[meter]));
+            g.setColour (juce::Colours::lightgrey);
+            g.drawText (meter == 0 ? "dry" : "wet", row.reduced (4, 0), juce::Justification::centredLeft, false);
+        }
+    }
+
+private:
+    // The bars and meters span this many dB below full scale
+    static constexpr float RANGE_DB = 72.0f;
+    static constexpr int METER_HEIGHT = 10;
+    // How much of the way a level meter falls towards a lower peak per tick
+    static constexpr float METER_RELEASE = 0.25f;
+
+    juce::Rectangle<int> regionBounds (int region) const
+    {
+        auto area = getLocalBounds().withTrimmedBottom (2 * METER_HEIGHT + 4);
+        const int width = area.getWidth() / PsxVerb::NUM_REGIONS;
+        return area.withX (region * width).withWidth (width - 2);
+    }
+
+    juce::Rectangle<int> meterBounds (int meter) const
+    {
+        auto area = getLocalBounds().removeFromBottom (2 * METER_HEIGHT + 2);
+        return meter == 0 ? area.removeFromTop (METER_HEIGHT) : area.removeFromBottom (METER_HEIGHT);
+    }
+
+    // 0 at RANGE_DB below full scale or quieter, 1 at full scale
+    static float proportion (float level)
+    {
+        const float db = juce::Decibels::gainToDecibels (level, -RANGE_DB);
+        return juce::jlimit (0.0f, 1.0f, 1.0f + db / RANGE_DB);
+    }
+
+    void timerCallback() override
+    {
+        bool received = false;
+        while (feed.pop (latest))
+            received = true;
+        if (!received)
+            return;
+
+        for (int region = 0; region < PsxVerb::NUM_REGIONS; ++region)
+        {
+            const auto column = regionBounds (region);
+            const int bar = juce::roundToInt (proportion (latest.ring.rms[region]) * (float) column.getHeight());
+            if (bar != bars[region])
+            {
+                bars[region] = bar;
+                repaint (column);
+            }
+        }
+
+        const float peaks[2] = { latest.levels.dry, latest.levels.wet };
+        for (int meter = 0; meter < 2; ++meter)
+        {
+            const auto row = meterBounds (meter);
+            const float target = proportion (peaks[meter]) * (float) row.getWidth();
+            // Peaks jump up and fall back gently
+            smoothed[meter] = std::max (target, smoothed[meter] + (target - smoothed[meter]) * METER_RELEASE);
+            const int width = juce::roundToInt (smoothed[meter]);
+            if (width != meters[meter])
+            {
+                meters[meter] = width;
+                repaint (row);
+            }
+        }
+    }
+
+    ScopeFeed& feed;
+    ScopeSnapshot latest {};
+
+    // As last painted, in pixels
+    int bars[PsxVerb::NUM_REGIONS] = {};
+    int meters[2] = {};
+    float smoothed[2] = {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReverbScope)
+};
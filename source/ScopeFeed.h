@@ -0,0 +1,75 @@
+#pragma once
+
+#include "PsxVerb.h"
+#include "SpscQueue.h"
+#include <algorithm>
+#include <atomic>
+
+// One frame of the editor's reverb scope
+struct ScopeSnapshot
+{
+    PsxVerb::RingEnergy ring;
+    // Peaks since the previous snapshot, see PsxVerb::takeLevels()
+    PsxVerb::Levels levels;
+};
+
+// Carries decimated snapshots of the reverb from the audio thread to the
+// editor, which never touches the ring itself. Until an editor listens,
+// update() returns straight away. While one does, each block scans a few
+// ring cells per sample (see PsxVerb::scanRing) and a snapshot goes out at
+// most SNAPSHOT_HZ times a second through a small lock-free FIFO; when the
+// editor falls behind, snapshots are dropped, never waited for.
+class ScopeFeed
+{
+public:
+    static constexpr int SNAPSHOT_HZ = 30;
+
+    // Not while processBlock is running
+    void prepare (double sampleRate)
+    {
+        interval = std::max (1, (int) (sampleRate / SNAPSHOT_HZ));
+        countdown = interval;
+        ring_ready = false;
+        pending = {};
+    }
+
+    // Message thread
+    void setListening (bool shouldListen) { listening.store (shouldListen, std::memory_order_relaxed); }
+    bool pop (ScopeSnapshot& snapshot) { return snapshots.pop (snapshot); }
+
+    // Audio thread, after the reverb has run. Verb is PsxVerb or anything
+    // with its scanRing() and takeLevels().
+    template <typename Verb>
+    void update (Verb& verb, int numSamples)
+    {
+        if (!listening.load (std::memory_order_relaxed))
+            return;
+
+        const auto levels = verb.takeLevels();
+        pending.levels.dry = std::max (pending.levels.dry, levels.dry);
+        pending.levels.wet = std::max (pending.levels.wet, levels.wet);
+        if (verb.scanRing ((uint32_t) numSamples * SCAN_CELLS_PER_SAMPLE, pending.ring))
+            ring_ready = true;
+
+        countdown -= numSamples;
+        if (countdown > 0 || !ring_ready)
+            return;
+
+        snapshots.push (pending);
+        pending.levels = {};
+        countdown = interval;
+    }
+
+private:
+    // Two reads per sample at PsxVerb's scan stride; even the longest ring
+    // at 96 kHz is covered about ten times a second
+    static constexpr uint32_t SCAN_CELLS_PER_SAMPLE = 32;
+
+    std::atomic<bool> listening { false };
+    SpscQueue<ScopeSnapshot, 16> snapshots;
+
+    int interval = 1470;
+    int countdown = 1470;
+    bool ring_ready = false;
+    ScopeSnapshot pending {};
+};
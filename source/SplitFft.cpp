@@ -0,0 +1,95 @@
+#include "SplitFft.h"
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+namespace
+{
+    // One stage's butterflies over a pair of half-blocks
+    void butterflies(float* __restrict ar, float* __restrict ai, float* __restrict br, float* __restrict bi,
+        const float* __restrict c, const float* __restrict s, int h)
+    {
+        for (int j = 0; j < h; j++) {
+            const float tr = br[j] * c[j] - bi[j] * s[j];
+            const float ti = br[j] * s[j] + bi[j] * c[j];
+            br[j] = ar[j] - tr;
+            bi[j] = ai[j] - ti;
+            ar[j] += tr;
+            ai[j] += ti;
+        }
+    }
+}
+
+SplitFft::SplitFft(int fftSize)
+    : size (fftSize)
+{
+    assert (size >= 2 && (size & (size - 1)) == 0);
+
+    int bits = 0;
+    while ((1 << bits) < size)
+        bits++;
+    for (uint32_t i = 0; i < (uint32_t) size; i++) {
+        uint32_t reversed = 0;
+        for (int b = 0; b < bits; b++)
+            reversed |= ((i >> b) & 1u) << (bits - 1 - b);
+        if (i < reversed) {
+            swaps.push_back(i);
+            swaps.push_back(reversed);
+        }
+    }
+
+    // Stage h starts at h - 1, so the tables hold size - 1 entries in all
+    cosines.reserve((size_t) size);
+    sines.reserve((size_t) size);
+    for (int h = 1; h < size; h *= 2) {
+        for (int j = 0; j < h; j++) {
+            const double angle = -3.14159265358979323846 * j / h;
+            cosines.push_back((float) std::cos(angle));
+            sines.push_back((float) std::sin(angle));
+        }
+    }
+}
+
+void SplitFft::forward(float* re, float* im) const {
+    for (size_t s = 0; s < swaps.size(); s += 2) {
+        std::swap(re[swaps[s]], re[swaps[s + 1]]);
+        std::swap(im[swaps[s]], im[swaps[s + 1]]);
+    }
+
+    // The first two stages' twiddles are 1 and -i, so they go together as
+    // one pass of radix-4 butterflies with no multiplies
+    int h = 1;
+    if (size >= 4) {
+        for (int base = 0; base < size; base += 4) {
+            float* r = re + base;
+            float* i = im + base;
+            const float r0 = r[0] + r[1], i0 = i[0] + i[1];
+            const float r1 = r[0] - r[1], i1 = i[0] - i[1];
+            const float r2 = r[2] + r[3], i2 = i[2] + i[3];
+            const float r3 = r[2] - r[3], i3 = i[2] - i[3];
+            r[0] = r0 + r2;
+            i[0] = i0 + i2;
+            r[2] = r0 - r2;
+            i[2] = i0 - i2;
+            // (r3 + i i3) * -i
+            r[1] = r1 + i3;
+            i[1] = i1 - r3;
+            r[3] = r1 - i3;
+            i[3] = i1 + r3;
+        }
+        h = 4;
+    }
+
+    for (; h < size; h *= 2) {
+        const float* c = cosines.data() + h - 1;
+        const float* s = sines.data() + h - 1;
+        for (int base = 0; base < size; base += 2 * h)
+            butterflies(re + base, im + base, re + base + h, im + base + h, c, s, h);
+    }
+}
+
+void SplitFft::inverse(float* re, float* im) const {
+    // Swapping the real and imaginary parts conjugates and multiplies by i,
+    // which turns the forward transform into the inverse one
+    forward(im, re);
+}
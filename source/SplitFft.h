@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Radix-2 complex FFT, in place on separate real and imaginary arrays. Every
+// butterfly stage runs down contiguous stretches of both, which vectorizes
+// without shuffles. Tables are built by the constructor; transforms allocate
+// nothing and can run on several threads at once.
+class SplitFft {
+public:
+    // size must be a power of two
+    explicit SplitFft(int size);
+
+    int getSize() const { return size; }
+
+    void forward(float* re, float* im) const;
+    // Unscaled, so inverse(forward(x)) is size * x
+    void inverse(float* re, float* im) const;
+
+private:
+    int size;
+    // Index pairs the bit-reversal permutation swaps
+    std::vector<uint32_t> swaps;
+    // exp(-i pi j / h) for j < h, for each stage's half-length h in turn
+    std::vector<float> cosines, sines;
+};
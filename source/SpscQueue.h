@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Fixed-size single-producer single-consumer queue. One thread pushes and
+// one other thread pops; neither ever allocates, locks or waits, so the
+// audio thread can be either end. A push onto a full queue fails rather
+// than overwriting the oldest item, which the consumer may be reading.
+//
+// Capacity must be a power of two; the queue holds Capacity - 1 items.
+template <typename T, uint32_t Capacity>
+class SpscQueue
+{
+public:
+    static_assert (Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    // Producer
+    bool push (const T& item)
+    {
+        const uint32_t write = write_index.load (std::memory_order_relaxed);
+        const uint32_t next = (write + 1) & MASK;
+        if (next == read_index.load (std::memory_order_acquire))
+            return false;
+
+        items[write] = item;
+        write_index.store (next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer
+    bool pop (T& item)
+    {
+        const uint32_t read = read_index.load (std::memory_order_relaxed);
+        if (read == write_index.load (std::memory_order_acquire))
+            return false;
+
+        item = items[read];
+        read_index.store ((read + 1) & MASK, std::memory_order_release);
+        return true;
+    }
+
+    // Either side; only a snapshot while the other side is running
+    bool empty() const
+    {
+        return read_index.load (std::memory_order_acquire) == write_index.load (std::memory_order_acquire);
+    }
+
+private:
+    static constexpr uint32_t MASK = Capacity - 1;
+
+    // Each index on its own cache line, so the two threads don't keep
+    // stealing one line from each other
+    alignas (64) std::atomic<uint32_t> write_index { 0 };
+    alignas (64) std::atomic<uint32_t> read_index { 0 };
+    T items[Capacity];
+};
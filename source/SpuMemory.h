@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+// Owns the reverb's SPU RAM. The block only ever grows, so re-initialising at
+// the same or a lower rate (or switching engines) reuses it without touching
+// the allocator. New blocks come back zeroed.
+class SpuMemory {
+public:
+    SpuMemory() = default;
+    ~SpuMemory() { std::free (block); }
+
+    SpuMemory (const SpuMemory&) = delete;
+    SpuMemory& operator= (const SpuMemory&) = delete;
+
+    // Returns at least numBytes of storage, nullptr if that can't be had
+    void* reserve (size_t numBytes)
+    {
+        if (numBytes > size) {
+            std::free (block);
+            block = std::calloc (numBytes, 1);
+            size = block != nullptr ? numBytes : 0;
+        }
+        return block;
+    }
+
+    void* data() const { return block; }
+    size_t capacity() const { return size; }
+
+private:
+    void* block = nullptr;
+    size_t size = 0;
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Set by CMake's PSXVERB_TELEMETRY option for the plugin; anything else
+// that includes this gets the empty version
+#ifndef PSXVERB_TELEMETRY
+    #define PSXVERB_TELEMETRY 0
+#endif
+
+#if PSXVERB_TELEMETRY
+    #include "SpscQueue.h"
+#endif
+
+// What one processBlock call did and how long it took
+struct BlockRecord
+{
+    // Since Telemetry::prepare()
+    double start_seconds;
+    float wall_seconds;
+    // How long the block lasts at the current sample rate
+    float budget_seconds;
+    int num_samples;
+    int preset;
+    int crush;
+    bool preset_changed;
+    // Took longer to process than it takes to play
+    bool overrun;
+};
+
+#if PSXVERB_TELEMETRY
+
+// Times processBlock from the audio thread. That side only reads the
+// clock, stores a few atomics and pushes onto a fixed-size queue: nothing
+// allocates, locks or waits. The meters (load, peak, overruns) can be
+// read from any thread; the full per-block records are queued only while
+// someone is recording them (see TraceWriter), and a full queue drops
+// records rather than blocking.
+class Telemetry
+{
+public:
+    static constexpr bool enabled = true;
+
+    // Not while processBlock is running
+    void prepare (double sampleRate)
+    {
+        sample_rate = sampleRate;
+        smoothed_load = 0.0f;
+        load.store (0.0f, std::memory_order_relaxed);
+        peak_load.store (0.0f, std::memory_order_relaxed);
+        epoch = Clock::now();
+    }
+
+    // Audio thread, around the whole of processBlock
+    void beginBlock() { block_start = Clock::now(); }
+
+    void endBlock (int numSamples, int preset, int crush, bool presetChanged)
+    {
+        const auto end = Clock::now();
+        const float wall = std::chrono::duration<float> (end - block_start).count();
+        const float budget = (float) (numSamples / sample_rate);
+        const float blockLoad = budget > 0.0f ? wall / budget : 0.0f;
+        const bool overrun = wall > budget;
+
+        // One pole over blocks, weighted by block length so the meter
+        // settles in about LOAD_SECONDS whatever the host's block size
+        const float weight = budget < LOAD_SECONDS ? budget / LOAD_SECONDS : 1.0f;
+        smoothed_load += (blockLoad - smoothed_load) * weight;
+        load.store (smoothed_load, std::memory_order_relaxed);
+        if (blockLoad > peak_load.load (std::memory_order_relaxed))
+            peak_load.store (blockLoad, std::memory_order_relaxed);
+        if (overrun)
+            overruns.fetch_add (1, std::memory_order_relaxed);
+
+        if (recording.load (std::memory_order_relaxed))
+        {
+            const BlockRecord record {
+                std::chrono::duration<double> (block_start - epoch).count(),
+                wall,
+                budget,
+                numSamples,
+                preset,
+                crush,
+                presetChanged,
+                overrun
+            };
+            if (!records.push (record))
+                dropped.fetch_add (1, std::memory_order_relaxed);
+        }
+    }
+
+    // Any thread. Load is processing time over block duration, so 1 means
+    // the block took exactly as long as it plays for.
+    float getLoad() const { return load.load (std::memory_order_relaxed); }
+    // Highest single-block load since the last call
+    float takePeakLoad() { return peak_load.exchange (0.0f, std::memory_order_relaxed); }
+    uint64_t getOverruns() const { return overruns.load (std::memory_order_relaxed); }
+    // Records lost to a full queue
+    uint64_t getDropped() const { return dropped.load (std::memory_order_relaxed); }
+
+    // Consumer side, one thread at a time
+    void setRecording (bool shouldRecord) { recording.store (shouldRecord, std::memory_order_relaxed); }
+    bool pop (BlockRecord& record) { return records.pop (record); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // About a second and a half of 64-sample blocks at 192 kHz
+    static constexpr uint32_t QUEUE_SIZE = 4096;
+    static constexpr float LOAD_SECONDS = 0.3f;
+
+    double sample_rate = 44100.0;
+    Clock::time_point epoch = Clock::now();
+    Clock::time_point block_start;
+    float smoothed_load = 0.0f;
+
+    std::atomic<float> load { 0.0f };
+    std::atomic<float> peak_load { 0.0f };
+    std::atomic<uint64_t> overruns { 0 };
+    std::atomic<uint64_t> dropped { 0 };
+    std::atomic<bool> recording { false };
+
+    SpscQueue<BlockRecord, QUEUE_SIZE> records;
+};
+
+#else
+
+// Telemetry compiled out: same interface, no state, nothing to call
+class Telemetry
+{
+public:
+    static constexpr bool enabled = false;
+
+    void prepare (double) {}
+    void beginBlock() {}
+    void endBlock (int, int, int, bool) {}
+
+    float getLoad() const { return 0.0f; }
+    float takePeakLoad() { return 0.0f; }
+    uint64_t getOverruns() const { return 0; }
+    uint64_t getDropped() const { return 0; }
+
+    void setRecording (bool) {}
+    bool pop (BlockRecord&) { return false; }
+};
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Telemetry.h"
+#include <juce_gui_basics/juce_gui_basics.h>
+
+#if PSXVERB_TELEMETRY
+
+// Live DSP load and overrun count for the editor, polled from the
+// telemetry's atomics on the message thread
+class TelemetryMeter : public juce::Component, private juce::Timer
+{
+public:
+    explicit TelemetryMeter (Telemetry& source)
+        : telemetry (source)
+    {
+        startTimerHz (REFRESH_HZ);
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        auto area = getLocalBounds().toFloat();
+        g.setColour (juce::Colours::black.withAlpha (0.4f));
+        g.fillRoundedRectangle (area, 3.0f);
+
+        // The bar shows the smoothed load, the tick the worst block lately
+        const float width = area.getWidth();
+        const auto colour = load < 0.5f ? juce::Colours::seagreen : load < 0.9f ? juce::Colours::orange : juce::Colours::red;
+        g.setColour (colour.withAlpha (0.7f));
+        g.fillRoundedRectangle (area.withWidth (width * juce::jmin (load, 1.0f)), 3.0f);
+        g.setColour (juce::Colours::white.withAlpha (0.6f));
+        g.fillRect (area.withX (area.getX() + width * juce::jmin (peak, 1.0f) - 1.0f).withWidth (2.0f));
+
+        g.setColour (juce::Colours::white);
+        g.setFont (12.0f);
+        auto text = "DSP " + juce::String (juce::roundToInt (load * 100.0f)) + "%"
+                    + "  peak " + juce::String (juce::roundToInt (peak * 100.0f)) + "%"
+                    + "  overruns " + juce::String ((juce::int64) overruns);
+        g.drawText (text, getLocalBounds().reduced (6, 0), juce::Justification::centredLeft, false);
+    }
+
+private:
+    static constexpr int REFRESH_HZ = 15;
+
+    void timerCallback() override
+    {
+        load = telemetry.getLoad();
+        peak = telemetry.takePeakLoad();
+        overruns = telemetry.getOverruns();
+        repaint();
+    }
+
+    Telemetry& telemetry;
+    float load = 0.0f;
+    float peak = 0.0f;
+    uint64_t overruns = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TelemetryMeter)
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "TraceWriter.h"
+
+#if PSXVERB_TELEMETRY
+
+TraceWriter::TraceWriter (Telemetry& source, const juce::File& file)
+    : juce::Thread ("PsxVerb trace"),
+      telemetry (source),
+      stream (file)
+{
+    if (!stream.openedOk())
+        return;
+
+    stream.setPosition (0);
+    stream.truncate();
+    stream << "start_s,wall_us,budget_us,samples,preset,crush,preset_changed,overrun\n";
+
+    telemetry.setRecording (true);
+    startThread (juce::Thread::Priority::low);
+}
+
+TraceWriter::~TraceWriter()
+{
+    if (!stream.openedOk())
+        return;
+
+    stopThread (2 * DRAIN_MS);
+    telemetry.setRecording (false);
+    drain();
+
+    if (telemetry.getDropped() > 0)
+        stream << "# " << (juce::int64) telemetry.getDropped() << " blocks dropped\n";
+    stream.flush();
+}
+
+void TraceWriter::run()
+{
+    while (!threadShouldExit())
+    {
+        drain();
+        wait (DRAIN_MS);
+    }
+}
+
+void TraceWriter::drain()
+{
+    BlockRecord record {};
+    while (telemetry.pop (record))
+    {
+        stream << juce::String (record.start_seconds, 6) << ","
+               << juce::String (record.wall_seconds * 1.0e6f, 1) << ","
+               << juce::String (record.budget_seconds * 1.0e6f, 1) << ","
+               << record.num_samples << ","
+               << record.preset << ","
+               << record.crush << ","
+               << (record.preset_changed ? 1 : 0) << ","
+               << (record.overrun ? 1 : 0) << "\n";
+    }
+    stream.flush();
+}
+
+#endif
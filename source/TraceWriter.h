@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Telemetry.h"
+#include <juce_core/juce_core.h>
+
+#if PSXVERB_TELEMETRY
+
+// Records a Telemetry's blocks for as long as it exists and writes them to
+// a CSV file from its own thread, one line per processBlock call. The
+// audio thread only ever pushes onto the telemetry's queue.
+class TraceWriter : private juce::Thread
+{
+public:
+    TraceWriter (Telemetry& source, const juce::File& file);
+    ~TraceWriter() override;
+
+    bool isOpen() const { return stream.openedOk(); }
+
+private:
+    static constexpr int DRAIN_MS = 100;
+
+    void run() override;
+    void drain();
+
+    Telemetry& telemetry;
+    juce::FileOutputStream stream;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TraceWriter)
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include <BlockEvents.h>
+#include <PsxVerb.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <vector>
+
+TEST_CASE ("Blocks split at events and sub-block ends", "[events]")
+{
+    BlockEvents<4> events;
+    events.add ({ 700, BlockEvent::Type::Crush, 2 });
+    events.add ({ 0, BlockEvent::Type::Preset, 1 });
+    events.add ({ 300, BlockEvent::Type::Preset, 5 });
+    events.add ({ 300, BlockEvent::Type::Crush, 1 });
+    CHECK_FALSE (events.add ({ 10, BlockEvent::Type::Crush, 3 }));
+
+    std::vector<int> segments, applied;
+    runSegments (
+        events, 1000, 256,
+        [&] (const BlockEvent& event) { applied.push_back (event.sample * 10 + event.value); },
+        [&] (int start, int length) {
+            segments.push_back (start);
+            segments.push_back (length);
+        });
+
+    // Same-sample events keep the order they were added in
+    CHECK (applied == std::vector<int> ({ 1, 3005, 3001, 7002 }));
+    CHECK (segments == std::vector<int> ({ 0, 256, 256, 44, 300, 256, 556, 144, 700, 256, 956, 44 }));
+}
+
+TEST_CASE ("The newest event of a type replaces the last in a full list", "[events]")
+{
+    BlockEvents<3> events;
+    events.add ({ 0, BlockEvent::Type::Crush, 1 });
+    events.add ({ 100, BlockEvent::Type::Preset, 2 });
+    events.add ({ 200, BlockEvent::Type::Preset, 3 });
+    CHECK (events.addLatest ({ 300, BlockEvent::Type::Preset, 4 }));
+    CHECK (events.addLatest ({ 50, BlockEvent::Type::Crush, 2 }));
+
+    REQUIRE (events.size() == 3);
+    CHECK (events[0].sample == 50);
+    CHECK (events[0].value == 2);
+    CHECK (events[1].sample == 100);
+    CHECK (events[2].sample == 300);
+    CHECK (events[2].value == 4);
+
+    // Nothing of its type to give up
+    BlockEvents<1> crushOnly;
+    crushOnly.add ({ 0, BlockEvent::Type::Crush, 1 });
+    CHECK_FALSE (crushOnly.addLatest ({ 10, BlockEvent::Type::Preset, 4 }));
+    CHECK (crushOnly[0].type == BlockEvent::Type::Crush);
+}
+
+TEST_CASE ("Gain ramps", "[events]")
+{
+    constexpr int length = 1000;
+    std::vector<float> left (length, 1.0f), right (length, 1.0f);
+
+    // With no wet signal the output is the input scaled by the dry gain
+    PsxVerb verb;
+    verb.init (48000.0f);
+    verb.setPreset (0);
+    verb.setGains (0.0f, 0.0f, 0);
+    verb.setGains (0.0f, 1.0f, 400);
+    for (int done = 0; done < length; done += 128)
+        verb.process (left.data() + done, right.data() + done, std::min (128, length - done));
+
+    const float inputGain = left[length - 1];
+    CHECK (inputGain != 0.0f);
+    bool rising = true;
+    for (int i = 1; i < 400; ++i)
+        rising = rising && std::abs (left[(size_t) i]) > std::abs (left[(size_t) i - 1]);
+    CHECK (rising);
+    CHECK (std::abs (left[199] - 0.5f * inputGain) < 1.0e-4f);
+    CHECK (left[399] == inputGain);
+    CHECK (left[600] == inputGain);
+}
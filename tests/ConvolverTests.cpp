@@ -0,0 +1,86 @@
+#include <PsxVerb.h>
+#include <PsxVerbConvolver.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr float rate = 48000.0f;
+
+    // A burst of noise and the silence after it, for the tail to ring out in
+    void burst (std::vector<float>& left, std::vector<float>& right, int length)
+    {
+        std::mt19937 rng (7);
+        std::uniform_real_distribution<float> noise (-0.5f, 0.5f);
+        left.assign ((size_t) length, 0.0f);
+        right.assign ((size_t) length, 0.0f);
+        for (int i = 0; i < (int) rate / 10; ++i)
+        {
+            left[(size_t) i] = noise (rng);
+            right[(size_t) i] = noise (rng);
+        }
+    }
+
+    template <typename Engine>
+    void run (Engine& engine, std::vector<float>& left, std::vector<float>& right, int blockSize)
+    {
+        const int length = (int) left.size();
+        for (int done = 0; done < length; done += blockSize)
+            engine.process (left.data() + done, right.data() + done, std::min (blockSize, length - done));
+    }
+}
+
+TEST_CASE ("Convolution matches the network", "[convolver]")
+{
+    for (int preset : { 0, 9 })
+    {
+        std::vector<float> left, right;
+        burst (left, right, (int) rate * 2);
+        auto expectedL = left, expectedR = right;
+
+        PsxVerb verb;
+        verb.init (rate);
+        verb.setPreset (preset);
+        verb.setWetGain (0.7f);
+        verb.setDryGain (0.4f);
+        run (verb, expectedL, expectedR, 512);
+
+        PsxVerbConvolver convolver;
+        convolver.init (rate);
+        convolver.setPreset (preset);
+        convolver.setWetGain (0.7f);
+        convolver.setDryGain (0.4f);
+        run (convolver, left, right, 441);
+
+        float deviation = 0.0f;
+        for (size_t i = 0; i < left.size(); ++i)
+            deviation = std::max ({ deviation, std::abs (left[i] - expectedL[i]), std::abs (right[i] - expectedR[i]) });
+        CHECK (deviation < 1.0e-5f);
+    }
+}
+
+TEST_CASE ("Worker threads don't change the output", "[convolver]")
+{
+    std::vector<float> serialL, serialR;
+    burst (serialL, serialR, (int) rate);
+    auto threadedL = serialL, threadedR = serialR;
+
+    PsxVerbConvolver serial, threaded;
+    threaded.setNumWorkers (2);
+    for (auto* convolver : { &serial, &threaded })
+    {
+        convolver->setMaxTailSeconds (1.0f);
+        convolver->init (rate);
+        convolver->setPreset (3);
+    }
+    CHECK (serial.getResponseLength() == (int) rate);
+
+    run (serial, serialL, serialR, 1000);
+    run (threaded, threadedL, threadedR, 1000);
+    CHECK (serialL == threadedL);
+    CHECK (serialR == threadedR);
+}
@@ -0,0 +1,116 @@
+#include <PsxVerb.h>
+#include <PsxVerbCrossfader.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr float rate = 48000.0f;
+    constexpr int blockSize = 512;
+    // PsxVerbCrossfader's 200 ms
+    constexpr int fadeSamples = 9600;
+
+    struct Stereo
+    {
+        std::vector<float> left, right;
+    };
+
+    Stereo makeNoise (int length)
+    {
+        Stereo s { std::vector<float> ((size_t) length), std::vector<float> ((size_t) length) };
+        std::mt19937 rng (5);
+        std::uniform_real_distribution<float> noise (-0.5f, 0.5f);
+        for (size_t i = 0; i < s.left.size(); ++i)
+        {
+            s.left[i] = noise (rng);
+            s.right[i] = noise (rng);
+        }
+        return s;
+    }
+
+    // A fresh reverb on preset, fed input from sample start on in host blocks
+    Stereo renderFrom (const Stereo& input, int preset, int start)
+    {
+        Stereo out = input;
+        PsxVerb verb;
+        verb.init (rate);
+        verb.setPreset (preset);
+        const int length = (int) input.left.size();
+        for (int done = start; done < length; done += blockSize)
+            verb.process (out.left.data() + done, out.right.data() + done, std::min (blockSize, length - done));
+        return out;
+    }
+
+    // Largest deviation from expected over [from, to)
+    float deviation (const Stereo& actual, const Stereo& expected, int from, int to)
+    {
+        float worst = 0.0f;
+        for (size_t i = (size_t) from; i < (size_t) to; ++i)
+            worst = std::max ({ worst, std::abs (actual.left[i] - expected.left[i]), std::abs (actual.right[i] - expected.right[i]) });
+        return worst;
+    }
+}
+
+TEST_CASE ("Preset changes crossfade", "[crossfader]")
+{
+    constexpr int length = 48000 * 3;
+    constexpr int switchAt = 60 * blockSize;
+    constexpr int queueAt = switchAt + 10 * blockSize;
+    const Stereo input = makeNoise (length);
+
+    // The same engines as the crossfader's, run without it. Bit for bit in
+    // strict builds, but -Ofast may split their blocks differently.
+    constexpr float tolerance = 1.0e-5f;
+    const Stereo from = renderFrom (input, 2, 0);
+    const Stereo to = renderFrom (input, 5, switchAt);
+
+    // Chosen before init, so it starts on the preset rather than fading to it
+    PsxVerbCrossfader verb;
+    verb.setPreset (2);
+    verb.init (rate);
+    Stereo out = input;
+    for (int done = 0; done < length; done += blockSize)
+    {
+        if (done == switchAt)
+            verb.setPreset (5);
+        // Still fading, so this one has to wait its turn
+        if (done == queueAt)
+            verb.setPreset (7);
+        verb.process (out.left.data() + done, out.right.data() + done, std::min (blockSize, length - done));
+    }
+
+    CHECK (deviation (out, from, 0, switchAt) < tolerance);
+
+    // The first sample after the switch is still almost all old preset, and
+    // every one after it moves a step along a straight line to the new one
+    CHECK (deviation (out, from, switchAt, switchAt + 1) < 1.0e-3f);
+    float fadeDeviation = 0.0f;
+    for (int k = 0; k < fadeSamples; ++k)
+    {
+        const auto i = (size_t) (switchAt + k);
+        const float gain = (float) (fadeSamples - k - 1) / (float) fadeSamples;
+        const float l = to.left[i] + (from.left[i] - to.left[i]) * gain;
+        const float r = to.right[i] + (from.right[i] - to.right[i]) * gain;
+        fadeDeviation = std::max ({ fadeDeviation, std::abs (out.left[i] - l), std::abs (out.right[i] - r) });
+    }
+    // The crossfader steps its gain by subtraction, which drifts a little
+    CHECK (fadeDeviation < 1.0e-4f);
+
+    // Then it's only the new preset, until the queued one starts once the
+    // old ring is clear. That happens on a block boundary within a second.
+    const int fadeEnd = switchAt + fadeSamples;
+    int queuedAt = -1;
+    for (int start = fadeEnd - fadeEnd % blockSize + blockSize; start < fadeEnd + (int) rate && queuedAt < 0; start += blockSize)
+    {
+        if (deviation (out, to, fadeEnd, start) >= tolerance)
+            break;
+        if (deviation (out, renderFrom (input, 7, start), start + fadeSamples, length) < tolerance)
+            queuedAt = start;
+    }
+    INFO ("queued preset started at " << queuedAt);
+    CHECK (queuedAt > fadeEnd);
+}
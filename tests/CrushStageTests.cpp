@@ -0,0 +1,130 @@
+#include <CrushStage.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+TEST_CASE ("Crush doesn't depend on block size", "[crush]")
+{
+    std::mt19937 rng (7);
+    std::uniform_real_distribution<float> noise (-1.0f, 1.0f);
+    std::vector<float> left (20000), right (20000);
+    for (size_t i = 0; i < left.size(); ++i)
+    {
+        left[i] = noise (rng);
+        right[i] = noise (rng);
+    }
+
+    for (int crush = 0; crush < 4; ++crush)
+    {
+        auto wholeL = left, wholeR = right, splitL = left, splitR = right;
+        CrushStage whole, split;
+        whole.setCrush (crush);
+        split.setCrush (crush);
+
+        whole.process (wholeL.data(), wholeR.data(), (int) wholeL.size());
+        std::uniform_int_distribution<int> size (1, 700);
+        for (int done = 0; done < (int) splitL.size();)
+        {
+            const int n = std::min ((int) splitL.size() - done, size (rng));
+            split.process (splitL.data() + done, splitR.data() + done, n);
+            done += n;
+        }
+
+        // Vector and scalar tails of the filters may round differently
+        float deviation = 0.0f;
+        for (size_t i = 0; i < left.size(); ++i)
+            deviation = std::max ({ deviation, std::abs (wholeL[i] - splitL[i]), std::abs (wholeR[i] - splitR[i]) });
+        CHECK (deviation <= (crush == 1 ? 1.0e-6f : 1.0f / 512.0f));
+    }
+}
+
+TEST_CASE ("Crush quantizes like std::round", "[crush]")
+{
+    // A ramp finer than either step size, across and past full scale
+    std::vector<float> input;
+    for (int i = -5000; i <= 5000; ++i)
+        input.push_back ((float) i / 4096.0f + (i % 3 == 0 ? 1.0e-4f : 0.0f));
+
+    for (int crush = 2; crush < 4; ++crush)
+    {
+        const float scale = crush == 2 ? 2048.0f : 512.0f;
+
+        // The same half-rate path without the quantizer gives what it rounds
+        auto crushed = input, halfRate = input;
+        CrushStage quantized, unquantized;
+        quantized.setCrush (crush);
+        unquantized.setCrush (1);
+        quantized.process (crushed.data(), nullptr, (int) crushed.size());
+        unquantized.process (halfRate.data(), nullptr, (int) halfRate.size());
+
+        int mismatches = 0;
+        for (size_t i = 0; i < input.size(); ++i)
+            mismatches += crushed[i] != std::round (halfRate[i] * scale) / scale;
+        CHECK (mismatches == 0);
+    }
+}
+
+TEST_CASE ("Every crush setting has the same latency", "[crush]")
+{
+    for (int crush = 0; crush < 4; ++crush)
+    {
+        // Split where Hi Def's delay is longer than the block and shorter
+        std::vector<float> impulse (200);
+        impulse[40] = 1.0f;
+        CrushStage stage;
+        stage.setCrush (crush);
+        stage.process (impulse.data(), nullptr, 7);
+        stage.process (impulse.data() + 7, nullptr, (int) impulse.size() - 7);
+
+        INFO ("crush " << crush);
+        const auto peak = std::max_element (impulse.begin(), impulse.end()) - impulse.begin();
+        CHECK (peak == 40 + stage.getLatency());
+    }
+
+    // Switching back to Hi Def carries on from the samples half rate heard
+    std::vector<float> ramp (100);
+    for (size_t i = 0; i < ramp.size(); ++i)
+        ramp[i] = (float) i;
+    CrushStage stage;
+    stage.setCrush (1);
+    stage.process (ramp.data(), nullptr, 50);
+    stage.setCrush (0);
+    stage.process (ramp.data() + 50, nullptr, 50);
+    CHECK (ramp[50] == (float) (50 - stage.getLatency()));
+    CHECK (ramp[99] == (float) (99 - stage.getLatency()));
+}
+
+TEST_CASE ("Leaving Hi Def carries on as if half rate had never stopped", "[crush]")
+{
+    // A sine well inside the half-rate passband, switched on a pair boundary
+    // so the stage that stayed on half rate splits its pairs the same way
+    std::vector<float> sine (2000);
+    for (size_t i = 0; i < sine.size(); ++i)
+        sine[i] = 0.5f * std::sin (0.05f * (float) i);
+
+    for (int crush = 1; crush < 4; ++crush)
+    {
+        auto switched = sine, steady = sine;
+        CrushStage switching, halfRate;
+        halfRate.setCrush (crush);
+        switching.process (switched.data(), nullptr, 1000);
+        switching.setCrush (crush);
+        switching.process (switched.data() + 1000, nullptr, 1000);
+        halfRate.process (steady.data(), nullptr, (int) steady.size());
+
+        float deviation = 0.0f, step = 0.0f;
+        for (size_t i = 1000; i < sine.size(); ++i)
+        {
+            deviation = std::max (deviation, std::abs (switched[i] - steady[i]));
+            step = std::max (step, std::abs (switched[i] - switched[i - 1]));
+        }
+
+        // The quantizers may round the two a step apart
+        INFO ("crush " << crush);
+        CHECK (deviation <= (crush == 1 ? 1.0e-6f : 1.0f / 512.0f));
+        CHECK (step < 0.05f);
+    }
+}
@@ -0,0 +1,299 @@
+#include "helpers/ReferenceVerb.h"
+#include <PsxVerb.h>
+#include <PsxVerbBank.h>
+#include <PsxVerbCrossfader.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Differential tests: every optimized engine is fed the same signals as
+// ReferenceVerb, the original scalar loop, and must stay within its own
+// tolerances for the largest sample deviation and for the mismatch in tail
+// energy, in dB. Where an engine is only meant to sound alike rather than
+// match sample for sample (native rate, and fixed point on full-scale
+// noise) it gets an infinite deviation tolerance and is held to the tail
+// energy alone. The summary also gives each engine's worst error energy
+// relative to the reference's, the measure of what the 16-bit float rings
+// cost in quality.
+
+namespace
+{
+    enum class Signal { Impulse, Noise, Silence, Denormal };
+
+    const char* signalName (Signal signal)
+    {
+        switch (signal)
+        {
+            case Signal::Impulse: return "impulse";
+            case Signal::Noise: return "full-scale noise";
+            case Signal::Silence: return "silence";
+            case Signal::Denormal: return "denormal tail";
+        }
+        return "";
+    }
+
+    struct Stereo
+    {
+        std::vector<float> left, right;
+    };
+
+    // Input for the first inputSeconds, then silence so the tail rings out
+    constexpr float inputSeconds = 0.1f;
+    constexpr float tailSeconds = 0.4f;
+
+    Stereo makeSignal (Signal signal, int inputLength, int length, unsigned seed)
+    {
+        Stereo s { std::vector<float> ((size_t) length), std::vector<float> ((size_t) length) };
+        std::mt19937 rng (seed);
+        std::uniform_real_distribution<float> noise (-1.0f, 1.0f);
+
+        switch (signal)
+        {
+            case Signal::Impulse:
+                s.left[0] = 1.0f;
+                s.right[7] = -1.0f;
+                break;
+            case Signal::Noise:
+                for (int i = 0; i < inputLength; ++i)
+                {
+                    s.left[(size_t) i] = noise (rng) < 0.0f ? -1.0f : 1.0f;
+                    s.right[(size_t) i] = noise (rng) < 0.0f ? -1.0f : 1.0f;
+                }
+                break;
+            case Signal::Silence:
+                break;
+            case Signal::Denormal:
+                // Well below FLT_MIN, so the whole network runs on subnormals
+                for (int i = 0; i < inputLength; ++i)
+                {
+                    s.left[(size_t) i] = noise (rng) * 1.0e-39f;
+                    s.right[(size_t) i] = noise (rng) * 1.0e-39f;
+                }
+                break;
+        }
+        return s;
+    }
+
+    // Random host block sizes, including 1 and sizes past the engines' chunks
+    std::vector<int> makeSplits (int length, unsigned seed)
+    {
+        std::mt19937 rng (seed);
+        std::uniform_int_distribution<int> size (1, 1500);
+        std::vector<int> splits;
+        for (int done = 0; done < length;)
+        {
+            const int n = std::min (length - done, (rng() & 7) == 0 ? 1 : size (rng));
+            splits.push_back (n);
+            done += n;
+        }
+        return splits;
+    }
+
+    using Process = std::function<void (float*, float*, int)>;
+
+    struct Engine
+    {
+        const char* name;
+        std::function<Process (float rate, int preset)> create;
+        float maxDeviation;
+        double maxEnergyMismatch;
+        // Full-scale noise only, for engines that saturate where the float
+        // network doesn't. Zero takes the limits above.
+        float maxNoiseDeviation = 0.0f;
+        double maxNoiseEnergyMismatch = 0.0;
+
+        // Worst values seen, for the summary, noise apart
+        float worstDeviation = 0.0f;
+        double worstEnergyMismatch = 0.0;
+        float worstNoiseDeviation = 0.0f;
+        double worstNoiseEnergyMismatch = 0.0;
+        double worstError = -INFINITY;
+    };
+
+    template <typename Verb>
+    void configure (Verb& verb, int preset)
+    {
+        verb.setPreset (preset);
+        verb.setWetGain (0.7f);
+        verb.setDryGain (0.4f);
+        verb.setMasterGain (0.9f);
+    }
+
+    Process makePsxVerb (float rate, int preset, PsxVerb::Engine kind, bool native, PsxVerb::Layout layout = PsxVerb::Layout::Shared)
+    {
+        auto verb = std::make_shared<PsxVerb>();
+        verb->setEngine (kind);
+        verb->setNativeRate (native);
+        verb->setLayout (layout);
+        verb->init (rate);
+        configure (*verb, preset);
+        return [verb] (float* l, float* r, int n) { verb->process (l, r, n); };
+    }
+
+    Stereo render (const Stereo& input, const std::vector<int>& splits, const Process& process)
+    {
+        Stereo out = input;
+        int done = 0;
+        for (int n : splits)
+        {
+            process (out.left.data() + done, out.right.data() + done, n);
+            done += n;
+        }
+        return out;
+    }
+
+    double tailEnergy (const Stereo& s, int from)
+    {
+        double energy = 0.0;
+        for (size_t i = (size_t) from; i < s.left.size(); ++i)
+            energy += (double) s.left[i] * s.left[i] + (double) s.right[i] * s.right[i];
+        return energy;
+    }
+}
+
+TEST_CASE ("Optimized engines match the reference", "[equivalence]")
+{
+    std::vector<Engine> engines = {
+        { "block", [] (float rate, int preset) { return makePsxVerb (rate, preset, PsxVerb::Engine::Float, false); }, 1.0e-4f, 1.0e-3 },
+        { "lines", [] (float rate, int preset) { return makePsxVerb (rate, preset, PsxVerb::Engine::Float, false, PsxVerb::Layout::Lines); }, 1.0e-4f, 1.0e-3 },
+        { "crossfader",
+            [] (float rate, int preset) {
+                // Configured before init, so it starts on the preset rather than fading to it
+                auto verb = std::make_shared<PsxVerbCrossfader>();
+                configure (*verb, preset);
+                verb->init (rate);
+                return Process ([verb] (float* l, float* r, int n) { verb->process (l, r, n); });
+            },
+            1.0e-4f,
+            1.0e-3 },
+        { "bank",
+            [] (float rate, int preset) {
+                auto bank = std::make_shared<PsxVerbBank> (1);
+                bank->init (rate);
+                bank->setPreset (0, preset);
+                bank->setWetGain (0, 0.7f);
+                bank->setDryGain (0, 0.4f);
+                bank->setMasterGain (0, 0.9f);
+                return Process ([bank] (float* l, float* r, int n) { bank->process (&l, &r, n); });
+            },
+            1.0e-4f,
+            1.0e-3 },
+        // Truncating 16-bit arithmetic, within a few steps of the float
+        // network until full-scale noise drives that past 4.0, where this
+        // one saturates, hence the wide margin for noise alone
+        { "fixed", [] (float rate, int preset) { return makePsxVerb (rate, preset, PsxVerb::Engine::Fixed, false); }, 1.0e-3f, 0.1, INFINITY, 12.0 },
+        // Float arithmetic over a ring of 16-bit floats. Rounding every write
+        // leaves noise about 65 dB down for half floats, 45 dB for bfloat16.
+        { "half", [] (float rate, int preset) { return makePsxVerb (rate, preset, PsxVerb::Engine::Half, false); }, 5.0e-3f, 0.02 },
+        { "bfloat", [] (float rate, int preset) { return makePsxVerb (rate, preset, PsxVerb::Engine::BFloat, false); }, 4.0e-2f, 0.2 },
+        // Resampled, so delayed and band-limited to 11 kHz; at 96 kHz that
+        // alone takes several dB off the tail
+        { "native", [] (float rate, int preset) { return makePsxVerb (rate, preset, PsxVerb::Engine::Float, true); }, INFINITY, 9.0 },
+    };
+
+    // 88.2 kHz has no preset-specialized kernels and runs the generic ones
+    unsigned seed = 1;
+    for (float rate : { 44100.0f, 48000.0f, 88200.0f, 96000.0f })
+    {
+        const int inputLength = (int) (rate * inputSeconds);
+        const int length = inputLength + (int) (rate * tailSeconds);
+
+        for (int preset = 0; preset < 10; ++preset)
+        {
+            for (Signal signal : { Signal::Impulse, Signal::Noise, Signal::Silence, Signal::Denormal })
+            {
+                const Stereo input = makeSignal (signal, inputLength, length, ++seed);
+
+                ReferenceVerb reference;
+                reference.init (rate);
+                configure (reference, preset);
+                const Stereo expected = render (input, makeSplits (length, ++seed), [&] (float* l, float* r, int n) { reference.process (l, r, n); });
+                const double expectedEnergy = tailEnergy (expected, inputLength);
+
+                for (auto& engine : engines)
+                {
+                    const Stereo actual = render (input, makeSplits (length, ++seed), engine.create (rate, preset));
+
+                    float deviation = 0.0f;
+                    double errorEnergy = 0.0;
+                    bool finite = true;
+                    for (size_t i = 0; i < (size_t) length; ++i)
+                    {
+                        const float errorL = actual.left[i] - expected.left[i];
+                        const float errorR = actual.right[i] - expected.right[i];
+                        finite = finite && std::isfinite (actual.left[i]) && std::isfinite (actual.right[i]);
+                        deviation = std::max ({ deviation, std::abs (errorL), std::abs (errorR) });
+                        errorEnergy += (double) errorL * errorL + (double) errorR * errorR;
+                    }
+
+                    // In dB, with a floor so silent tails compare as equal
+                    const double energy = tailEnergy (actual, inputLength);
+                    const double mismatch = std::abs (10.0 * std::log10 ((energy + 1.0e-9) / (expectedEnergy + 1.0e-9)));
+
+                    const bool noise = signal == Signal::Noise && engine.maxNoiseDeviation > 0.0f;
+                    const float maxDeviation = noise ? engine.maxNoiseDeviation : engine.maxDeviation;
+                    const double maxEnergyMismatch = noise ? engine.maxNoiseEnergyMismatch : engine.maxEnergyMismatch;
+                    float& worstDeviation = noise ? engine.worstNoiseDeviation : engine.worstDeviation;
+                    double& worstEnergyMismatch = noise ? engine.worstNoiseEnergyMismatch : engine.worstEnergyMismatch;
+                    worstDeviation = std::max (worstDeviation, deviation);
+                    worstEnergyMismatch = std::max (worstEnergyMismatch, mismatch);
+                    // Silence and subnormals have no level to be relative to
+                    const double energyFrom0 = tailEnergy (expected, 0);
+                    if (energyFrom0 > 1.0e-6 && errorEnergy > 0.0)
+                        engine.worstError = std::max (engine.worstError, 10.0 * std::log10 (errorEnergy / energyFrom0));
+
+                    INFO (engine.name << ", preset " << preset << ", " << rate << " Hz, " << signalName (signal));
+                    CAPTURE (deviation, mismatch);
+                    CHECK (finite);
+                    CHECK (deviation <= maxDeviation);
+                    CHECK (mismatch <= maxEnergyMismatch);
+                }
+            }
+        }
+    }
+
+    for (const auto& engine : engines)
+    {
+        std::printf ("%-12s max deviation %.3g (limit %.3g), tail energy mismatch %.3g dB (limit %.3g dB), error %.1f dB\n",
+            engine.name,
+            (double) engine.worstDeviation,
+            (double) engine.maxDeviation,
+            engine.worstEnergyMismatch,
+            engine.maxEnergyMismatch,
+            engine.worstError);
+        if (engine.maxNoiseDeviation > 0.0f)
+            std::printf ("%-12s on noise: max deviation %.3g (limit %.3g), tail energy mismatch %.3g dB (limit %.3g dB)\n",
+                "",
+                (double) engine.worstNoiseDeviation,
+                (double) engine.maxNoiseDeviation,
+                engine.worstNoiseEnergyMismatch,
+                engine.maxNoiseEnergyMismatch);
+    }
+}
+
+TEST_CASE ("16-bit float rings round the same in every kernel", "[equivalence]")
+{
+    // The block kernel has to read back exactly what the per-sample loop
+    // stored, or the output would depend on where host blocks end
+    for (auto engine : { PsxVerb::Engine::Half, PsxVerb::Engine::BFloat })
+    {
+        for (int preset = 0; preset < 10; ++preset)
+        {
+            INFO ("engine " << (int) engine << ", preset " << preset);
+            constexpr float rate = 48000.0f;
+            const int length = (int) (rate * (inputSeconds + tailSeconds));
+            const Stereo input = makeSignal (Signal::Noise, (int) (rate * inputSeconds), length, (unsigned) preset);
+
+            const Stereo oneByOne = render (input, std::vector<int> ((size_t) length, 1), makePsxVerb (rate, preset, engine, false));
+            const Stereo blocks = render (input, makeSplits (length, (unsigned) preset), makePsxVerb (rate, preset, engine, false));
+            CHECK (oneByOne.left == blocks.left);
+            CHECK (oneByOne.right == blocks.right);
+        }
+    }
+}
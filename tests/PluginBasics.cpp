@@ -3,6 +3,20 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
 
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+namespace
+{
+    // Bit for bit, since -Ofast builds assume there are no infinities and
+    // may fold std::isinf to false
+    bool isInfinite (double seconds)
+    {
+        return std::bit_cast<uint64_t> (seconds) == std::bit_cast<uint64_t> (std::numeric_limits<double>::infinity());
+    }
+}
+
 TEST_CASE ("one is equal to one", "[dummy]")
 {
     REQUIRE (1 == 1);
@@ -22,6 +36,85 @@ TEST_CASE ("Plugin instance", "[instance]")
         CHECK_THAT (testPlugin.getName().toStdString(),
             Catch::Matchers::Equals ("PsxVerb"));
     }
+
+    SECTION ("Latency is reported and holds for every crush setting")
+    {
+        testPlugin.prepareToPlay (48000.0, 512);
+        const int latency = CrushStage().getLatency();
+        CHECK (testPlugin.getLatencySamples() == latency);
+
+        auto* crush = dynamic_cast<juce::AudioParameterChoice*> (testPlugin.parameters.getParameter ("crush"));
+        REQUIRE (crush != nullptr);
+        juce::AudioBuffer<float> buffer (2, 512);
+        juce::MidiBuffer midi;
+        for (int setting : { 1, 3, 0, 2 })
+        {
+            *crush = setting;
+            buffer.clear();
+            testPlugin.processBlock (buffer, midi);
+            CHECK (testPlugin.getLatencySamples() == latency);
+        }
+    }
+
+    SECTION ("A restored preset is there from the start")
+    {
+        // Shorter than Room's, so a fade from Room would report Room's
+        auto* presetParameter = dynamic_cast<juce::AudioParameterChoice*> (testPlugin.parameters.getParameter ("preset"));
+        REQUIRE (presetParameter != nullptr);
+        *presetParameter = 8;
+        testPlugin.prepareToPlay (48000.0, 512);
+
+        juce::AudioBuffer<float> buffer (2, 512);
+        buffer.clear();
+        juce::MidiBuffer midi;
+        testPlugin.processBlock (buffer, midi);
+
+        PsxVerb quiet;
+        quiet.setPreset (8);
+        CHECK (testPlugin.getTailLengthSeconds() == quiet.getTailSeconds());
+    }
+
+    SECTION ("MIDI program changes select presets")
+    {
+        testPlugin.prepareToPlay (48000.0, 2048);
+        juce::AudioBuffer<float> buffer (2, 2048);
+        buffer.clear();
+        juce::MidiBuffer midi;
+        midi.addEvent (juce::MidiMessage::programChange (1, 7), 300);
+        testPlugin.processBlock (buffer, midi);
+
+        // Chaos Echo rings forever. The parameter follows on the message
+        // thread, and until it does the old value doesn't switch back.
+        CHECK (isInfinite (testPlugin.getTailLengthSeconds()));
+        midi.clear();
+        testPlugin.processBlock (buffer, midi);
+        CHECK (isInfinite (testPlugin.getTailLengthSeconds()));
+    }
+
+    SECTION ("The preset parameter overrides an earlier program change")
+    {
+        testPlugin.prepareToPlay (48000.0, 2048);
+        juce::AudioBuffer<float> buffer (2, 2048);
+        buffer.clear();
+        juce::MidiBuffer midi;
+        midi.addEvent (juce::MidiMessage::programChange (1, 7), 300);
+        testPlugin.processBlock (buffer, midi);
+        midi.clear();
+
+        // Automation before the timer has caught up with the program change
+        auto* presetParameter = dynamic_cast<juce::AudioParameterChoice*> (testPlugin.parameters.getParameter ("preset"));
+        REQUIRE (presetParameter != nullptr);
+        *presetParameter = 2;
+
+        // Past Chaos Echo's fade and the clearing of its ring
+        for (int block = 0; block < 48; ++block)
+            testPlugin.processBlock (buffer, midi);
+
+        PsxVerb studio;
+        studio.setPreset (2);
+        CHECK (testPlugin.getTailLengthSeconds() == studio.getTailSeconds());
+        CHECK (presetParameter->getIndex() == 2);
+    }
 }
 
 
@@ -0,0 +1,240 @@
+#include "helpers/RealtimeGuard.h"
+#include <PluginProcessor.h>
+#include <PsxVerb.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <utility>
+
+namespace
+{
+    constexpr double rate = 48000.0;
+    // Long enough for a preset switch to fade and for the old ring to be
+    // cleared, so the next switch isn't held back
+    constexpr double transitionSeconds = 0.6;
+
+    void setIndex (PluginProcessor& plugin, const char* id, int index)
+    {
+        auto* parameter = dynamic_cast<juce::AudioParameterChoice*> (plugin.parameters.getParameter (id));
+        REQUIRE (parameter != nullptr);
+        *parameter = index;
+    }
+
+    void setGain (PluginProcessor& plugin, const char* id, float gain)
+    {
+        auto* parameter = dynamic_cast<juce::AudioParameterFloat*> (plugin.parameters.getParameter (id));
+        REQUIRE (parameter != nullptr);
+        *parameter = gain;
+    }
+
+    // Drives a prepared plugin through every transition, one guarded
+    // processBlock at a time, with noise in so no reverb goes to sleep
+    class Driver
+    {
+    public:
+        Driver (PluginProcessor& p, int numChannels, int size, const juce::String& layoutName)
+            : plugin (p), buffer (numChannels, size), blockSize (size), layout (layoutName)
+        {
+            // The editor's paths: scope snapshots and telemetry records
+            plugin.getScopeFeed().setListening (true);
+            plugin.getTelemetry().setRecording (true);
+        }
+
+        void run (const juce::String& what, int numBlocks = 1)
+        {
+            // A block has to be done in the time it plays for, with a little
+            // slack for the test machine's own scheduling
+            const double budget = std::max (blockSize / rate, 0.002);
+            for (int b = 0; b < numBlocks; ++b)
+            {
+                for (int c = 0; c < buffer.getNumChannels(); ++c)
+                    for (int i = 0; i < blockSize; ++i)
+                        buffer.setSample (c, i, noise (rng));
+
+                checkRealtime (layout + ", " + juce::String (blockSize) + "-sample blocks, " + what, budget, [&] {
+                    plugin.processBlock (buffer, midi);
+                });
+                midi.clear();
+
+                // As the trace writer and the scope would
+                BlockRecord record;
+                while (plugin.getTelemetry().pop (record)) {}
+                ScopeSnapshot snapshot;
+                while (plugin.getScopeFeed().pop (snapshot)) {}
+            }
+        }
+
+        int blocksFor (double seconds) const { return (int) std::ceil (seconds * rate / blockSize); }
+
+        PluginProcessor& plugin;
+        juce::AudioBuffer<float> buffer;
+        juce::MidiBuffer midi;
+        const int blockSize;
+
+    private:
+        const juce::String layout;
+        std::mt19937 rng { 1 };
+        std::uniform_real_distribution<float> noise { -0.5f, 0.5f };
+    };
+
+    void driveEveryTransition (Driver& driver)
+    {
+        driver.run ("the first block");
+
+        for (int from = 0; from < 10; ++from)
+        {
+            for (int to = 0; to < 10; ++to)
+            {
+                if (from == to)
+                    continue;
+                setIndex (driver.plugin, "preset", from);
+                driver.run ("preset " + juce::String (from), driver.blocksFor (transitionSeconds));
+                setIndex (driver.plugin, "preset", to);
+                driver.run ("preset " + juce::String (from) + " to " + juce::String (to), driver.blocksFor (transitionSeconds));
+            }
+        }
+
+        for (int from = 0; from < 4; ++from)
+        {
+            for (int to = 0; to < 4; ++to)
+            {
+                setIndex (driver.plugin, "crush", from);
+                driver.run ("crush " + juce::String (from));
+                setIndex (driver.plugin, "crush", to);
+                driver.run ("crush " + juce::String (from) + " to " + juce::String (to), 2);
+            }
+        }
+
+        for (float gain : { 0.0f, 1.0f, 0.3f, 0.0f })
+        {
+            setGain (driver.plugin, "wet_gain", gain);
+            setGain (driver.plugin, "dry_gain", 1.0f - gain);
+            driver.run ("gains " + juce::String (gain), 2);
+        }
+
+        // Last, since nothing here runs the timer that moves the preset
+        // parameter after them. 12 isn't a preset and is ignored.
+        for (int program : { 3, 7, 0, 9, 12, 5 })
+        {
+            driver.midi.addEvent (juce::MidiMessage::programChange (1, program), driver.blockSize / 2);
+            driver.run ("program change " + juce::String (program), driver.blocksFor (transitionSeconds));
+        }
+    }
+}
+
+TEST_CASE ("The real-time guard catches violations", "[realtime]")
+{
+    {
+        realtime::ScopedAudioThread audioThread (1.0);
+        std::vector<float> allocated (64);
+        juce::ignoreUnused (allocated);
+    }
+    CHECK_FALSE (realtime::takeViolations().empty());
+
+    if (realtime::catchesLocks())
+    {
+        std::mutex mutex;
+        {
+            realtime::ScopedAudioThread audioThread (1.0);
+            const std::lock_guard<std::mutex> lock (mutex);
+        }
+        CHECK_FALSE (realtime::takeViolations().empty());
+    }
+
+    // Arithmetic on memory that's already there is fine
+    float samples[64] = {};
+    {
+        realtime::ScopedAudioThread audioThread (1.0);
+        for (auto& sample : samples)
+            sample += 1.0f;
+    }
+    CHECK (realtime::takeViolations().empty());
+}
+
+TEST_CASE ("processBlock is real-time safe", "[realtime]")
+{
+    auto gui = juce::ScopedJuceInitialiser_GUI {};
+
+    for (int blockSize : { 32, 512 })
+    {
+        SECTION ("Stereo, " + std::to_string (blockSize))
+        {
+            PluginProcessor plugin;
+            plugin.prepareToPlay (rate, blockSize);
+            Driver driver (plugin, 2, blockSize, "stereo");
+            driveEveryTransition (driver);
+        }
+
+        SECTION ("5.1, " + std::to_string (blockSize))
+        {
+            PluginProcessor plugin;
+            juce::AudioProcessor::BusesLayout layout;
+            layout.inputBuses.add (juce::AudioChannelSet::create5point1());
+            layout.outputBuses.add (juce::AudioChannelSet::create5point1());
+            REQUIRE (plugin.setBusesLayout (layout));
+            plugin.prepareToPlay (rate, blockSize);
+            Driver driver (plugin, 6, blockSize, "5.1");
+            driveEveryTransition (driver);
+        }
+    }
+}
+
+TEST_CASE ("PsxVerb::process is real-time safe", "[realtime]")
+{
+    constexpr int blockSize = 512;
+    std::vector<float> left (blockSize), right (blockSize);
+    std::mt19937 rng (2);
+    std::uniform_real_distribution<float> noise (-0.5f, 0.5f);
+
+    const std::pair<PsxVerb::Engine, const char*> engines[] = {
+        { PsxVerb::Engine::Float, "float" },
+        { PsxVerb::Engine::Fixed, "fixed" },
+        { PsxVerb::Engine::Half, "half" },
+        { PsxVerb::Engine::BFloat, "bfloat" },
+    };
+
+    for (const auto& [engine, engineName] : engines)
+    {
+        for (auto layout : { PsxVerb::Layout::Shared, PsxVerb::Layout::Lines })
+        {
+            for (bool native : { false, true })
+            {
+                PsxVerb verb;
+                verb.setEngine (engine);
+                verb.setLayout (layout);
+                verb.setNativeRate (native);
+                verb.init ((float) rate);
+
+                const auto name = juce::String (engineName)
+                                  + (layout == PsxVerb::Layout::Lines ? ", lines" : ", shared")
+                                  + (native ? ", native rate" : "");
+
+                // Every preset from every other, switched and cleared the
+                // way the crossfader does it on the audio thread
+                for (int from = 0; from < 10; ++from)
+                {
+                    for (int to = 0; to < 10; ++to)
+                    {
+                        for (size_t i = 0; i < left.size(); ++i)
+                        {
+                            left[i] = noise (rng);
+                            right[i] = noise (rng);
+                        }
+
+                        checkRealtime (name + ", preset " + juce::String (from) + " to " + juce::String (to), blockSize / rate, [&] {
+                            verb.setPreset (from);
+                            verb.process (left.data(), right.data(), blockSize);
+                            verb.startClearing();
+                            while (!verb.clearSome (16384)) {}
+                            verb.setPreset (to);
+                            verb.process (left.data(), right.data(), blockSize);
+                        });
+                    }
+                }
+            }
+        }
+    }
+}
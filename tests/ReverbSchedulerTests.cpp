@@ -0,0 +1,105 @@
+#include <ReverbScheduler.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace
+{
+    constexpr int maxTasks = 96;
+
+    // How often each task ran, counted from any thread
+    struct Counts
+    {
+        std::unique_ptr<std::atomic<int>[]> runs = std::make_unique<std::atomic<int>[]> (maxTasks);
+
+        void reset()
+        {
+            for (int i = 0; i < maxTasks; ++i)
+                runs[(size_t) i] = 0;
+        }
+    };
+}
+
+TEST_CASE ("Every task runs exactly once", "[scheduler]")
+{
+    for (int numWorkers : { 0, 1, 3, 7 })
+    {
+        ReverbScheduler scheduler (numWorkers, maxTasks);
+        Counts counts;
+        auto task = [&counts] (int index) { counts.runs[(size_t) index].fetch_add (1); };
+
+        for (int round = 0; round < 500; ++round)
+        {
+            // Fewer tasks than threads, a few each and the full bound
+            const int numTasks = round % 4 == 0 ? 1 + round % 3 : round % 4 == 1 ? 13 : maxTasks;
+            counts.reset();
+
+            const int numSkipped = scheduler.run (numTasks, task);
+
+            INFO (numWorkers << " workers, round " << round << ", " << numTasks << " tasks");
+            CHECK (numSkipped == 0);
+            for (int i = 0; i < maxTasks; ++i)
+            {
+                CHECK (counts.runs[(size_t) i].load() == (i < numTasks ? 1 : 0));
+                if (i < numTasks)
+                    CHECK_FALSE (scheduler.wasSkipped (i));
+            }
+        }
+    }
+}
+
+TEST_CASE ("A missed deadline skips the tasks nobody started", "[scheduler]")
+{
+    using Clock = ReverbScheduler::Clock;
+
+    SECTION ("Already passed")
+    {
+        // The caller checks the deadline before each task, and with no
+        // workers nothing else can start one
+        ReverbScheduler scheduler (0, maxTasks);
+        Counts counts;
+        auto task = [&counts] (int index) { counts.runs[(size_t) index].fetch_add (1); };
+
+        CHECK (scheduler.run (maxTasks, task, Clock::now() - std::chrono::milliseconds (1)) == maxTasks);
+        for (int i = 0; i < maxTasks; ++i)
+        {
+            CHECK (scheduler.wasSkipped (i));
+            CHECK (counts.runs[(size_t) i].load() == 0);
+        }
+
+        // The next block starts over
+        CHECK (scheduler.run (maxTasks, task) == 0);
+        for (int i = 0; i < maxTasks; ++i)
+        {
+            CHECK_FALSE (scheduler.wasSkipped (i));
+            CHECK (counts.runs[(size_t) i].load() == 1);
+        }
+    }
+
+    SECTION ("Passing mid-block")
+    {
+        // Far more work than fits before the deadline
+        ReverbScheduler scheduler (2, maxTasks);
+        Counts counts;
+        auto task = [&counts] (int index) {
+            std::this_thread::sleep_for (std::chrono::milliseconds (2));
+            counts.runs[(size_t) index].fetch_add (1);
+        };
+
+        const int numSkipped = scheduler.run (maxTasks, task, Clock::now() + std::chrono::milliseconds (10));
+        CHECK (numSkipped > 0);
+
+        // Each task either ran or was reported skipped, never both
+        int numReported = 0;
+        for (int i = 0; i < maxTasks; ++i)
+        {
+            INFO ("task " << i);
+            CHECK (counts.runs[(size_t) i].load() == (scheduler.wasSkipped (i) ? 0 : 1));
+            numReported += scheduler.wasSkipped (i) ? 1 : 0;
+        }
+        CHECK (numReported == numSkipped);
+    }
+}
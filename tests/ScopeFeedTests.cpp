@@ -0,0 +1,47 @@
+#include <PsxVerb.h>
+#include <ScopeFeed.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+TEST_CASE ("Scope snapshots", "[scope]")
+{
+    constexpr float rate = 48000.0f;
+    constexpr int blockSize = 480;
+
+    PsxVerb verb;
+    verb.init (rate);
+    verb.setPreset (4);
+    ScopeFeed feed;
+    feed.prepare (rate);
+
+    std::vector<float> left (blockSize), right (blockSize);
+    auto runSeconds = [&] (float seconds, float level) {
+        for (int done = 0; done < (int) (rate * seconds); done += blockSize)
+        {
+            std::fill (left.begin(), left.end(), level);
+            std::fill (right.begin(), right.end(), -level);
+            verb.process (left.data(), right.data(), blockSize);
+            feed.update (verb, blockSize);
+        }
+    };
+
+    ScopeSnapshot snapshot {};
+    runSeconds (0.5f, 0.25f);
+    CHECK_FALSE (feed.pop (snapshot));
+
+    feed.setListening (true);
+    runSeconds (0.5f, 0.25f);
+    int received = 0;
+    while (feed.pop (snapshot))
+        ++received;
+
+    // At most SNAPSHOT_HZ a second, and the FIFO holds fewer than that
+    CHECK (received > 0);
+    CHECK (received <= ScopeFeed::SNAPSHOT_HZ / 2);
+    CHECK (snapshot.levels.dry > 0.2f);
+    CHECK (snapshot.levels.wet > 0.0f);
+    for (float rms : snapshot.ring.rms)
+        CHECK (rms > 0.0f);
+    CHECK (snapshot.ring.seconds[0] > 0.0f);
+}
@@ -0,0 +1,166 @@
+#include "helpers/ReferenceVerb.h"
+#include <PsxVerb.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Runs an impulse, a long silence and a second impulse through preset in
+    // host-sized blocks. Returns whether the network slept in between and the
+    // largest deviation from the reference, which never sleeps.
+    float sleepAndWake (int preset, bool& slept)
+    {
+        constexpr float rate = 48000.0f;
+        constexpr int blockSize = 441;
+        const int length = (int) rate * 6;
+        const int wake = length - (int) rate + 333;
+
+        std::vector<float> left ((size_t) length), right ((size_t) length);
+        left[100] = right[100] = 1.0f;
+        left[(size_t) wake] = 0.5f;
+        right[(size_t) wake] = -0.5f;
+        auto expectedL = left, expectedR = right;
+
+        PsxVerb verb;
+        verb.init (rate);
+        verb.setPreset (preset);
+        slept = false;
+        for (int done = 0; done < length; done += blockSize)
+        {
+            const int n = std::min (blockSize, length - done);
+            verb.process (left.data() + done, right.data() + done, n);
+            slept = slept || verb.isSleeping();
+        }
+
+        ReferenceVerb reference;
+        reference.init (rate);
+        reference.setPreset (preset);
+        reference.process (expectedL.data(), expectedR.data(), length);
+
+        float deviation = 0.0f;
+        for (size_t i = 0; i < left.size(); ++i)
+            deviation = std::max ({ deviation, std::abs (left[i] - expectedL[i]), std::abs (right[i] - expectedR[i]) });
+        return deviation;
+    }
+}
+
+TEST_CASE ("Silent reverbs sleep and wake on the sample", "[sleep]")
+{
+    bool slept = false;
+
+    SECTION ("Room sleeps once its tail is gone")
+    {
+        const float deviation = sleepAndWake (0, slept);
+        CHECK (slept);
+        CHECK (deviation < 1.0e-5f);
+    }
+
+    SECTION ("Chaos Echo repeats forever and never does")
+    {
+        sleepAndWake (7, slept);
+        CHECK_FALSE (slept);
+    }
+}
+
+TEST_CASE ("Tail lengths", "[sleep]")
+{
+    PsxVerb verb;
+    verb.init (48000.0f);
+
+    verb.setPreset (0);
+    CHECK (verb.getTailSeconds() > 1.0);
+    CHECK_FALSE (verb.ringsForever());
+    verb.setPreset (7);
+    CHECK (verb.ringsForever());
+    verb.setPreset (9);
+    CHECK (verb.getTailSeconds() == 0.0);
+    CHECK_FALSE (verb.ringsForever());
+}
+
+TEST_CASE ("Tails end within their stated length", "[sleep]")
+{
+    // The table's own measure: a second of full-scale noise, then silence
+    for (float rate : { 44100.0f, 96000.0f })
+    {
+        for (int preset = 0; preset < 10; ++preset)
+        {
+            PsxVerb verb;
+            verb.init (rate);
+            verb.setPreset (preset);
+            if (verb.ringsForever())
+                continue;
+
+            const int inputLength = (int) rate;
+            const int length = inputLength + (int) (rate * 11.0f);
+            std::vector<float> left ((size_t) length), right ((size_t) length);
+            std::mt19937 rng ((unsigned) preset + 1);
+            std::uniform_int_distribution<int> sign (0, 1);
+            for (size_t i = 0; i < (size_t) inputLength; ++i)
+            {
+                left[i] = sign (rng) ? 1.0f : -1.0f;
+                right[i] = sign (rng) ? 1.0f : -1.0f;
+            }
+
+            ReferenceVerb reference;
+            reference.init (rate);
+            reference.setPreset (preset);
+            reference.process (left.data(), right.data(), length);
+
+            // Past the last sample at or above PsxVerb's SILENCE
+            size_t end = (size_t) inputLength;
+            for (size_t i = end; i < left.size(); ++i)
+                if (std::abs (left[i]) >= 1.0e-6f || std::abs (right[i]) >= 1.0e-6f)
+                    end = i + 1;
+
+            INFO ("preset " << preset << ", " << rate << " Hz");
+            CHECK ((double) (end - (size_t) inputLength) / rate <= verb.getTailSeconds());
+        }
+    }
+}
+
+TEST_CASE ("A cleared ring is silent in either layout", "[sleep]")
+{
+    // Twice, since each clear decides how much of the ring the next one
+    // covers
+    constexpr float rate = 48000.0f;
+    constexpr int length = 24000;
+    for (auto layout : { PsxVerb::Layout::Shared, PsxVerb::Layout::Lines })
+    {
+        for (int preset = 0; preset < 10; ++preset)
+        {
+            PsxVerb verb;
+            verb.setLayout (layout);
+            verb.init (rate);
+            verb.setPreset (preset);
+
+            std::mt19937 rng ((unsigned) preset);
+            std::uniform_real_distribution<float> noise (-1.0f, 1.0f);
+            std::vector<float> left ((size_t) length), right ((size_t) length);
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                for (size_t i = 0; i < left.size(); ++i)
+                {
+                    left[i] = noise (rng);
+                    right[i] = noise (rng);
+                }
+                verb.process (left.data(), right.data(), length);
+                verb.startClearing();
+                while (!verb.clearSome (16384)) {}
+            }
+
+            std::fill (left.begin(), left.end(), 0.0f);
+            std::fill (right.begin(), right.end(), 0.0f);
+            verb.process (left.data(), right.data(), length);
+            float loudest = 0.0f;
+            for (size_t i = 0; i < left.size(); ++i)
+                loudest = std::max ({ loudest, std::abs (left[i]), std::abs (right[i]) });
+
+            INFO ("preset " << preset << ", layout " << (layout == PsxVerb::Layout::Lines ? "lines" : "shared"));
+            CHECK (loudest == 0.0f);
+        }
+    }
+}
@@ -0,0 +1,189 @@
+#include <PsxVerb.h>
+#include <PsxVerbCrossfader.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // L R C LFE Ls Rs, in the order JUCE lays out 5.1
+    const PsxVerb::Speaker surround51[] = {
+        { -1.0f, true }, { 1.0f, true }, { 0.0f, true }, { 0.0f, false }, { -1.0f, true }, { 1.0f, true }
+    };
+    constexpr int numSpeakers = 6;
+
+    using Bus = std::vector<std::vector<float>>;
+
+    Bus makeNoise (int numChannels, int length)
+    {
+        Bus bus ((size_t) numChannels, std::vector<float> ((size_t) length));
+        std::mt19937 rng (7);
+        std::uniform_real_distribution<float> noise (-0.5f, 0.5f);
+        for (auto& channel : bus)
+            for (int i = 0; i < length / 4; ++i)
+                channel[(size_t) i] = noise (rng);
+        return bus;
+    }
+
+    // From sample start on, leaving anything before it as it is
+    template <typename Verb>
+    void runInBlocks (Verb& verb, Bus& bus, int blockSize, int start = 0)
+    {
+        const int length = (int) bus[0].size();
+        std::vector<float*> pointers (bus.size());
+        for (int done = start; done < length; done += blockSize)
+        {
+            for (size_t c = 0; c < bus.size(); ++c)
+                pointers[c] = bus[c].data() + done;
+            verb.processSpeakers (pointers.data(), std::min (blockSize, length - done));
+        }
+    }
+
+    float correlation (const std::vector<float>& a, const std::vector<float>& b)
+    {
+        double ab = 0.0, aa = 0.0, bb = 0.0;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            ab += (double) a[i] * b[i];
+            aa += (double) a[i] * a[i];
+            bb += (double) b[i] * b[i];
+        }
+        return (float) (ab / std::sqrt (aa * bb + 1.0e-30));
+    }
+}
+
+TEST_CASE ("A stereo pair of speakers is process()", "[speakers]")
+{
+    const PsxVerb::Speaker stereo[] = { { -1.0f, true }, { 1.0f, true } };
+    auto bus = makeNoise (2, 24000);
+    auto expected = bus;
+
+    PsxVerb speakers, plain;
+    speakers.setSpeakers (stereo, 2);
+    speakers.init (48000.0f);
+    plain.init (48000.0f);
+    speakers.setPreset (4);
+    plain.setPreset (4);
+
+    runInBlocks (speakers, bus, 300);
+    plain.process (expected[0].data(), expected[1].data(), (int) expected[0].size());
+
+    float deviation = 0.0f;
+    for (size_t c = 0; c < 2; ++c)
+        for (size_t i = 0; i < bus[c].size(); ++i)
+            deviation = std::max (deviation, std::abs (bus[c][i] - expected[c][i]));
+    CHECK (deviation < 1.0e-6f);
+}
+
+TEST_CASE ("5.1 from one network", "[speakers]")
+{
+    for (int preset : { 0, 1, 4, 7 })
+    {
+        for (auto engine : { PsxVerb::Engine::Float, PsxVerb::Engine::Fixed, PsxVerb::Engine::Half })
+        {
+            INFO ("preset " << preset << " engine " << (int) engine);
+            auto bus = makeNoise (numSpeakers, 48000);
+            auto reference = bus;
+
+            // The extra speakers' taps must not depend on where blocks end
+            PsxVerb verb, oneByOne;
+            for (auto* v : { &verb, &oneByOne })
+            {
+                v->setSpeakers (surround51, numSpeakers);
+                v->setEngine (engine);
+                v->init (48000.0f);
+                v->setPreset (preset);
+            }
+            runInBlocks (verb, bus, 441);
+            runInBlocks (oneByOne, reference, 1);
+
+            // Identical in strict builds; -Ofast may contract the block and
+            // per-sample kernels differently
+            float deviation = 0.0f;
+            for (size_t c = 0; c < bus.size(); ++c)
+                for (size_t i = 0; i < bus[c].size(); ++i)
+                    deviation = std::max (deviation, std::abs (bus[c][i] - reference[c][i]));
+            CHECK (deviation < 1.0e-6f);
+
+            // Surrounds and centre ring on, decorrelated from the fronts; the
+            // LFE only carries its dry input
+            const size_t tail = bus[0].size() / 4;
+            std::vector<std::vector<float>> tails;
+            for (auto& channel : bus)
+                tails.emplace_back (channel.begin() + (long) tail, channel.end());
+            for (int c : { 2, 4, 5 })
+            {
+                CHECK (*std::max_element (tails[(size_t) c].begin(), tails[(size_t) c].end()) > 1.0e-3f);
+                CHECK (std::abs (correlation (tails[(size_t) c], tails[0])) < 0.5f);
+                CHECK (std::abs (correlation (tails[(size_t) c], tails[1])) < 0.5f);
+            }
+            CHECK (std::abs (correlation (tails[4], tails[5])) < 0.5f);
+            CHECK (*std::max_element (tails[3].begin(), tails[3].end()) == 0.0f);
+        }
+    }
+}
+
+TEST_CASE ("Crossfading presets across a 5.1 bus", "[speakers]")
+{
+    constexpr float rate = 48000.0f;
+    constexpr int blockSize = 512;
+    constexpr int switchAt = 20 * blockSize;
+    // PsxVerbCrossfader's 200 ms
+    constexpr int fadeSamples = 9600;
+    const auto input = makeNoise (numSpeakers, 48000);
+
+    // The two presets on their own, the new one fed from the switch on
+    auto renderFrom = [&] (int preset, int start) {
+        Bus bus = input;
+        PsxVerb verb;
+        verb.setSpeakers (surround51, numSpeakers);
+        verb.init (rate);
+        verb.setPreset (preset);
+        runInBlocks (verb, bus, blockSize, start);
+        return bus;
+    };
+    const Bus from = renderFrom (2, 0);
+    const Bus to = renderFrom (5, switchAt);
+
+    // Chosen before init, so it starts on the preset rather than fading to it
+    PsxVerbCrossfader verb;
+    verb.setSpeakers (surround51, numSpeakers);
+    verb.setPreset (2);
+    verb.init (rate);
+    Bus bus = input;
+    std::vector<float*> pointers (bus.size());
+    for (int done = 0; done < (int) bus[0].size(); done += blockSize)
+    {
+        if (done == switchAt)
+            verb.setPreset (5);
+        for (size_t c = 0; c < bus.size(); ++c)
+            pointers[c] = bus[c].data() + done;
+        verb.processSpeakers (pointers.data(), std::min (blockSize, (int) bus[0].size() - done));
+    }
+
+    // The old preset, then a straight line to the new one, then the new
+    // one alone. The crossfader steps its gain by subtraction, which
+    // drifts a little.
+    float beforeDeviation = 0.0f, fadeDeviation = 0.0f, afterDeviation = 0.0f;
+    for (size_t c = 0; c < bus.size(); ++c)
+    {
+        for (size_t i = 0; i < bus[c].size(); ++i)
+        {
+            const int k = (int) i - switchAt;
+            float expected = to[c][i];
+            if (k < 0)
+                expected = from[c][i];
+            else if (k < fadeSamples)
+                expected += (from[c][i] - to[c][i]) * (float) (fadeSamples - k - 1) / (float) fadeSamples;
+
+            float& deviation = k < 0 ? beforeDeviation : k < fadeSamples ? fadeDeviation : afterDeviation;
+            deviation = std::max (deviation, std::abs (bus[c][i] - expected));
+        }
+    }
+    CHECK (beforeDeviation < 1.0e-5f);
+    CHECK (fadeDeviation < 1.0e-4f);
+    CHECK (afterDeviation < 1.0e-5f);
+}
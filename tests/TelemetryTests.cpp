@@ -0,0 +1,91 @@
+#include <SpscQueue.h>
+#include <Telemetry.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <thread>
+
+TEST_CASE ("SPSC queue", "[telemetry]")
+{
+    SECTION ("Items come out in order and a full queue refuses more")
+    {
+        SpscQueue<int, 8> queue;
+        int pushed = 0;
+        while (queue.push (pushed))
+            ++pushed;
+        CHECK (pushed == 7);
+
+        int item = -1;
+        for (int i = 0; i < 7; ++i)
+        {
+            REQUIRE (queue.pop (item));
+            CHECK (item == i);
+        }
+        CHECK_FALSE (queue.pop (item));
+        CHECK (queue.empty());
+    }
+
+    SECTION ("Nothing is lost or reordered between two threads")
+    {
+        constexpr int count = 100000;
+        SpscQueue<int, 64> queue;
+        std::thread producer ([&queue] {
+            for (int i = 0; i < count; ++i)
+                while (!queue.push (i))
+                    std::this_thread::yield();
+        });
+
+        int expected = 0;
+        bool ordered = true;
+        while (expected < count)
+        {
+            int item;
+            if (queue.pop (item))
+                ordered = ordered && item == expected++;
+            else
+                std::this_thread::yield();
+        }
+        producer.join();
+        CHECK (ordered);
+        CHECK (queue.empty());
+    }
+}
+
+#if PSXVERB_TELEMETRY
+TEST_CASE ("Telemetry records blocks and overruns", "[telemetry]")
+{
+    Telemetry telemetry;
+    // 480 samples at 48 kHz gives each block 10 ms
+    telemetry.prepare (48000.0);
+
+    // Nothing is queued until someone records
+    telemetry.beginBlock();
+    telemetry.endBlock (480, 0, 0, false);
+    BlockRecord record {};
+    CHECK_FALSE (telemetry.pop (record));
+
+    telemetry.setRecording (true);
+    telemetry.beginBlock();
+    telemetry.endBlock (480, 3, 2, true);
+    telemetry.beginBlock();
+    std::this_thread::sleep_for (std::chrono::milliseconds (20));
+    telemetry.endBlock (480, 3, 2, false);
+
+    REQUIRE (telemetry.pop (record));
+    CHECK (record.num_samples == 480);
+    CHECK (record.preset == 3);
+    CHECK (record.crush == 2);
+    CHECK (record.preset_changed);
+    CHECK_FALSE (record.overrun);
+
+    REQUIRE (telemetry.pop (record));
+    CHECK_FALSE (record.preset_changed);
+    CHECK (record.overrun);
+    CHECK (record.wall_seconds > record.budget_seconds);
+
+    CHECK (telemetry.getOverruns() == 1);
+    CHECK (telemetry.takePeakLoad() > 1.0f);
+    CHECK (telemetry.takePeakLoad() == 0.0f);
+    CHECK (telemetry.getDropped() == 0);
+}
+#endif
@@ -0,0 +1,205 @@
+#include "RealtimeGuard.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if defined(__has_feature)
+    #if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+        #define REALTIME_GUARD_SANITIZED 1
+    #endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+    #define REALTIME_GUARD_SANITIZED 1
+#endif
+
+// glibc lets a program replace malloc as long as the replacements share its
+// heap, which forwarding to the __libc_ entry points does
+#if defined(__GLIBC__) && !defined(REALTIME_GUARD_SANITIZED)
+    #define REALTIME_GUARD_MALLOC 1
+#else
+    #define REALTIME_GUARD_MALLOC 0
+#endif
+
+#if defined(__linux__) && !defined(REALTIME_GUARD_SANITIZED)
+    #define REALTIME_GUARD_LOCKS 1
+    #include <dlfcn.h>
+    #include <pthread.h>
+#else
+    #define REALTIME_GUARD_LOCKS 0
+#endif
+
+namespace realtime
+{
+    namespace
+    {
+        // Keeps the first few of a scope, a runaway loop would only repeat them
+        constexpr size_t MAX_VIOLATIONS = 8;
+
+        // Plain thread-locals, so the hooks can read them before anything
+        // in the thread is constructed
+        thread_local bool audioThread = false;
+        // Set while recording, whose own allocations don't count
+        thread_local bool recording = false;
+
+        std::vector<Violation>& violations()
+        {
+            thread_local std::vector<Violation> recorded;
+            return recorded;
+        }
+
+        double now()
+        {
+            return juce::Time::getMillisecondCounterHiRes() / 1000.0;
+        }
+
+        void record (const char* what, bool withStack)
+        {
+            recording = true;
+            auto& recorded = violations();
+            if (recorded.size() < MAX_VIOLATIONS)
+                recorded.push_back ({ what, withStack ? juce::SystemStats::getStackBacktrace() : juce::String() });
+            recording = false;
+        }
+
+        inline void check (const char* what)
+        {
+            if (audioThread && !recording)
+                record (what, true);
+        }
+    }
+
+    ScopedAudioThread::ScopedAudioThread (double budgetSeconds)
+        : budget (budgetSeconds)
+    {
+        // Anything lazily set up on a thread's first allocation or backtrace
+        // happens here rather than inside the scope
+        violations().reserve (MAX_VIOLATIONS);
+        start = now();
+        audioThread = true;
+    }
+
+    ScopedAudioThread::~ScopedAudioThread()
+    {
+        audioThread = false;
+        const double elapsed = now() - start;
+#ifdef NDEBUG
+        if (elapsed > budget)
+        {
+            const auto what = "took " + juce::String (elapsed * 1000.0, 3) + " ms of a " + juce::String (budget * 1000.0, 3) + " ms budget";
+            record (what.toRawUTF8(), false);
+        }
+#else
+        juce::ignoreUnused (elapsed);
+#endif
+    }
+
+    std::vector<Violation> takeViolations()
+    {
+        std::vector<Violation> taken;
+        std::swap (taken, violations());
+        return taken;
+    }
+
+    bool catchesMalloc() { return REALTIME_GUARD_MALLOC; }
+    bool catchesLocks() { return REALTIME_GUARD_LOCKS; }
+}
+
+#if REALTIME_GUARD_MALLOC
+
+extern "C" {
+void* __libc_malloc (size_t);
+void* __libc_calloc (size_t, size_t);
+void* __libc_realloc (void*, size_t);
+void* __libc_memalign (size_t, size_t);
+void __libc_free (void*);
+
+void* malloc (size_t size)
+{
+    realtime::check ("malloc");
+    return __libc_malloc (size);
+}
+
+void* calloc (size_t count, size_t size)
+{
+    realtime::check ("calloc");
+    return __libc_calloc (count, size);
+}
+
+void* realloc (void* pointer, size_t size)
+{
+    realtime::check ("realloc");
+    return __libc_realloc (pointer, size);
+}
+
+void* memalign (size_t alignment, size_t size)
+{
+    realtime::check ("memalign");
+    return __libc_memalign (alignment, size);
+}
+
+void* aligned_alloc (size_t alignment, size_t size)
+{
+    realtime::check ("aligned_alloc");
+    return __libc_memalign (alignment, size);
+}
+
+int posix_memalign (void** pointer, size_t alignment, size_t size)
+{
+    realtime::check ("posix_memalign");
+    if (alignment < sizeof (void*) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    *pointer = __libc_memalign (alignment, size);
+    return *pointer != nullptr ? 0 : ENOMEM;
+}
+
+void free (void* pointer)
+{
+    if (pointer != nullptr)
+        realtime::check ("free");
+    __libc_free (pointer);
+}
+}
+
+#else
+
+// Without malloc, operator new and delete at least; the nothrow, array and
+// sized forms all come through these
+void* operator new (size_t size)
+{
+    realtime::check ("operator new");
+    if (void* pointer = std::malloc (size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete (void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        realtime::check ("operator delete");
+    std::free (pointer);
+}
+
+#endif
+
+#if REALTIME_GUARD_LOCKS
+
+// Found through the dynamic linker on first use. dlsym takes the loader's
+// own locks, not a pthread mutex, so it can't come back in here.
+extern "C" int pthread_mutex_lock (pthread_mutex_t* mutex)
+{
+    using Lock = int (*) (pthread_mutex_t*);
+    static std::atomic<Lock> next { nullptr };
+    Lock lock = next.load (std::memory_order_relaxed);
+    if (lock == nullptr)
+    {
+        lock = reinterpret_cast<Lock> (dlsym (RTLD_NEXT, "pthread_mutex_lock"));
+        next.store (lock, std::memory_order_relaxed);
+    }
+
+    realtime::check ("pthread_mutex_lock");
+    return lock (mutex);
+}
+
+#endif
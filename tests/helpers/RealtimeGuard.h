@@ -0,0 +1,57 @@
+#pragma once
+
+#include <catch2/catch_test_macros.hpp>
+#include <juce_core/juce_core.h>
+
+#include <vector>
+
+// Catches what the audio thread mustn't do: while a ScopedAudioThread is
+// alive on a thread, every heap allocation or free and every mutex it locks
+// there is recorded with a stack trace, and so is the whole scope taking
+// longer than its budget. Other threads are left alone.
+//
+// Allocations are caught through malloc and friends on glibc and through
+// operator new elsewhere, and mutexes through pthread_mutex_lock on Linux
+// (see RealtimeGuard.cpp). Sanitizer builds bring their own malloc, so they
+// only get operator new. The budget is only held to in optimized builds.
+namespace realtime
+{
+    struct Violation
+    {
+        juce::String what;
+        juce::String stack;
+    };
+
+    class ScopedAudioThread
+    {
+    public:
+        explicit ScopedAudioThread (double budgetSeconds);
+        ~ScopedAudioThread();
+
+    private:
+        double budget;
+        double start;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedAudioThread)
+    };
+
+    // What the calling thread's scopes recorded since the last call
+    std::vector<Violation> takeViolations();
+
+    // Whether this build can see allocations made through malloc, and locks
+    bool catchesMalloc();
+    bool catchesLocks();
+}
+
+// Runs code as the audio thread and fails the test with each violation
+template <typename Code>
+void checkRealtime (const juce::String& what, double budgetSeconds, Code&& code)
+{
+    {
+        realtime::ScopedAudioThread audioThread (budgetSeconds);
+        code();
+    }
+
+    for (const auto& violation : realtime::takeViolations())
+        FAIL_CHECK (what << ": " << violation.what << "\n" << violation.stack);
+}